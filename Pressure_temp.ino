@@ -1,14 +1,41 @@
 #include <Wire.h>
 #include <Adafruit_BMP280.h>
 
+// Flow control towards the host: set to match flow_control in bmp280.ini.
+// FLOW_RTSCTS waits while CTS_PIN (driven by the host's RTS, active low) is high.
+// FLOW_XONXOFF stops sending after XOFF (0x13) until XON (0x11) arrives.
+#define FLOW_NONE 0
+#define FLOW_RTSCTS 1
+#define FLOW_XONXOFF 2
+#define FLOW_CONTROL FLOW_NONE
+#define CTS_PIN 2
+
 Adafruit_BMP280 bmp;
 
 float temperature;
 float pressure;
+bool host_ready = true;
+
+void waitForHost() {
+#if FLOW_CONTROL == FLOW_RTSCTS
+  while (digitalRead(CTS_PIN) == HIGH);
+#elif FLOW_CONTROL == FLOW_XONXOFF
+  do {
+    while (Serial.available()) {
+      int c = Serial.read();
+      if (c == 0x13) host_ready = false;
+      else if (c == 0x11) host_ready = true;
+    }
+  } while (!host_ready);
+#endif
+}
 
 void setup() {
   pinMode(LED_BUILTIN, OUTPUT);
   Serial.begin(9600);
+#if FLOW_CONTROL == FLOW_RTSCTS
+  pinMode(CTS_PIN, INPUT_PULLUP);
+#endif
 
   if (!bmp.begin(0x76) && !bmp.begin(0x77)) {
     Serial.println("BMP280 not found!");
@@ -28,6 +55,7 @@ void loop() {
   pressure = bmp.readPressure() / 100.0F;
   float altitude = bmp.readAltitude(1013.25);
 
+  waitForHost();
   Serial.print("Temp: "); Serial.print(temperature); Serial.println(" °C");
   Serial.print("Pressure: "); Serial.print(pressure); Serial.println(" hPa");
   Serial.print("Altitude: "); Serial.print(altitude); Serial.println(" m");
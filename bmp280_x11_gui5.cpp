@@ -5,6 +5,13 @@
 #include <fcntl.h>
 #include <termios.h>
 #include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <sys/ioctl.h>
+#include <sys/eventfd.h>
+#include <linux/serial.h>
+#include <poll.h>
+#include <netdb.h>
 #include <ctime>
 #include <vector>
 #include <string>
@@ -18,6 +25,19 @@
 #include <algorithm>
 #include <array>
 #include <optional>
+#include <iomanip>
+#include <limits>
+#include <thread>
+#include <atomic>
+#include <future>
+#include <deque>
+#include <map>
+#include <set>
+#include <queue>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <type_traits>
 
 #define WIDTH 800
 #define HEIGHT 600
@@ -27,6 +47,43 @@
 #define RECONNECT_TIMEOUT 5
 #define STATS_WINDOW 300
 #define HIGHLIGHT_DURATION 0.5
+#define MENU_HEIGHT 30
+#define UART_ERROR_WINDOW 2
+#define SERIAL_MAX_READS 64
+#define SERIAL_STALL_US 500000
+#define OVERLOAD_BUDGET_US 100000
+#define OVERLOAD_CALM_US 5000000
+#define TW_MAX_GAP 60
+#define RANGE_INDEX_CAPACITY (1 << 20)
+#define RANGE_BLOCK 32
+#define RANGE_CHUNK 1024
+#define CAPTURE_QUEUE_LIMIT (1 << 20)
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_PATH "logs/analytics.ckpt"
+#define SINK_RING_CAPACITY 1024
+#define INGEST_QUEUE_BATCHES 1024
+#define CACHE_LINE 64
+#define EPOCH_MAX_THREADS 256
+#define ARCHIVE_BLOCK_RECORDS 4096
+#define ARCHIVE_CACHE_BLOCKS 256
+#define REORDER_MAX_HELD 4096
+#define MEMORY_DEFAULT_BUDGET_MB 128
+#define RANGE_INDEX_MIN_KEEP 4096
+#define DECIMATE_RAW_MAX_BUCKETS 60
+#define RAW_FETCH_LIMIT 32768
+#define ARCHIVE_MAGIC "BMPARC1\n"
+#define MP_LANES 8
+#define MP_DEFAULT_WINDOW 20
+#define MP_DEFAULT_TOP_K 3
+#define TILE_WIDTH 64
+#define TILE_HEIGHT 200
+#define TILE_MIN_LEVEL 3
+#define TILE_MAX_LEVEL 16
+#define TILE_CACHE_TILES 256
+#define TILE_DISK_MAX 4096
+#define TILE_FILLS_PER_FRAME 4
+#define TILE_DIR "logs/tiles"
+#define ARROW_BATCH_ROWS 65536
 
 struct DataPoint {
     float temperature;
@@ -38,6 +95,179 @@ struct Statistics {
     float min_temp, max_temp, avg_temp;
     float min_press, max_press, avg_press;
     int count;
+    float tw_avg_temp, tw_avg_press;
+};
+
+struct UartCounters {
+    int rx = 0, overrun = 0, frame = 0, parity = 0, brk = 0, buf_overrun = 0;
+    bool has_icount = false;
+    int queued = 0;
+};
+
+struct RangeStats {
+    int count;
+    float mean, min, max, stddev;
+    float slope_per_hour;
+    double duration;
+};
+
+class BinaryWriter {
+    std::string data;
+
+public:
+    template <typename T>
+    void put(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        data.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    void put_string(const std::string& str) {
+        put<uint32_t>(static_cast<uint32_t>(str.size()));
+        data.append(str);
+    }
+    const std::string& str() const { return data; }
+};
+
+class BinaryReader {
+    const std::string& data;
+    size_t pos;
+    bool ok = true;
+
+public:
+    BinaryReader(const std::string& buffer, size_t offset = 0) : data(buffer), pos(offset) {}
+
+    template <typename T>
+    T get() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value{};
+        if (!ok || pos + sizeof(T) > data.size()) {
+            ok = false;
+            return value;
+        }
+        std::memcpy(&value, data.data() + pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+    std::string get_string() {
+        uint32_t len = get<uint32_t>();
+        if (!ok || pos + len > data.size()) {
+            ok = false;
+            return {};
+        }
+        std::string str = data.substr(pos, len);
+        pos += len;
+        return str;
+    }
+    bool good() const { return ok; }
+};
+
+uint64_t fnv1a(const char* data, size_t len) {
+    uint64_t hash = 1469598103934665603ull;
+    for (size_t i = 0; i < len; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+template <typename... T>
+uint64_t hash_state(const T&... values) {
+    static_assert((std::is_trivially_copyable_v<T> && ...), "hash_state hashes object bytes");
+    uint64_t hash = 1469598103934665603ull;
+    ((hash = (hash ^ fnv1a(reinterpret_cast<const char*>(&values), sizeof(values))) * 1099511628211ull), ...);
+    return hash;
+}
+
+bool write_file_atomic(const std::string& path, const std::string& data) {
+    std::string temp_path = path + ".tmp";
+    std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+    if (!out) return false;
+    out.write(data.data(), data.size());
+    out.close();
+    if (out.fail()) return false;
+    std::error_code ec;
+    std::filesystem::rename(temp_path, path, ec);
+    return !ec;
+}
+
+void save_point(BinaryWriter& out, const std::optional<DataPoint>& point) {
+    out.put<uint8_t>(point.has_value());
+    if (point) out.put(*point);
+}
+
+std::optional<DataPoint> restore_point(BinaryReader& in) {
+    if (!in.get<uint8_t>()) return std::nullopt;
+    return in.get<DataPoint>();
+}
+
+enum class IntegralMethod { Step, Trapezoid };
+
+double segment_integral(float v0, float v1, double seconds, IntegralMethod method) {
+    if (seconds <= 0.0 || seconds > TW_MAX_GAP) return 0.0;
+    return method == IntegralMethod::Step ? v0 * seconds : 0.5 * (v0 + v1) * seconds;
+}
+
+struct Aggregate {
+    int count = 0;
+    double sum = 0.0;
+    float min = 0.0f, max = 0.0f;
+    double integral = 0.0;
+    double duration = 0.0;
+
+    void add_sample(float v) {
+        if (count == 0) min = max = v;
+        else {
+            min = std::min(min, v);
+            max = std::max(max, v);
+        }
+        sum += v;
+        ++count;
+    }
+    void add_segment(double area, double seconds) {
+        if (seconds == 0.0 || std::abs(seconds) > TW_MAX_GAP) return;
+        integral += area;
+        duration += seconds;
+    }
+    void merge(const Aggregate& other) {
+        if (other.count == 0) return;
+        if (count == 0) {
+            min = other.min;
+            max = other.max;
+        } else {
+            min = std::min(min, other.min);
+            max = std::max(max, other.max);
+        }
+        count += other.count;
+        sum += other.sum;
+        integral += other.integral;
+        duration += other.duration;
+    }
+    void save(BinaryWriter& out) const {
+        out.put(count);
+        out.put(sum);
+        out.put(min);
+        out.put(max);
+        out.put(integral);
+        out.put(duration);
+    }
+    void restore(BinaryReader& in) {
+        count = in.get<int>();
+        sum = in.get<double>();
+        min = in.get<float>();
+        max = in.get<float>();
+        integral = in.get<double>();
+        duration = in.get<double>();
+    }
+    float mean() const { return count > 0 ? static_cast<float>(sum / count) : 0.0f; }
+    float time_weighted_mean() const { return duration > 0.0 ? static_cast<float>(integral / duration) : mean(); }
+};
+
+struct Annotation {
+    time_t start;
+    time_t end;
+    bool is_temp;
+    bool is_motif;
+    int rank;
+    float distance;
 };
 
 class CircularBuffer {
@@ -86,667 +316,4712 @@ public:
         }
         return cache[index];
     }
-};
-
-class SerialPort {
-    int fd;
-public:
-    SerialPort(const std::string& port, speed_t baud) : fd(-1) {
-        fd = open(port.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
-        if (fd == -1) throw std::runtime_error("Failed to open serial port: " + port);
-
-        termios tty{};
-        if (tcgetattr(fd, &tty) != 0) {
-            close(fd);
-            throw std::runtime_error("Failed to get serial attributes");
+    size_t lower_index(time_t t) const {
+        size_t lo = 0, hi = size;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if ((*this)[mid].timestamp < t) lo = mid + 1;
+            else hi = mid;
         }
-        cfsetispeed(&tty, baud);
-        cfsetospeed(&tty, baud);
-        tty.c_cflag |= (CLOCAL | CREAD);
-        tty.c_cflag &= ~CSIZE;
-        tty.c_cflag |= CS8;
-        tty.c_cflag &= ~(PARENB | CSTOPB | CRTSCTS);
-        tty.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG);
-        tty.c_iflag &= ~(IXON | IXOFF | IXANY);
-        tty.c_oflag &= ~OPOST;
-        tty.c_cc[VMIN] = 0;
-        tty.c_cc[VTIME] = 1;
-
-        if (tcsetattr(fd, TCSANOW, &tty) != 0) {
-            close(fd);
-            throw std::runtime_error("Failed to set serial attributes");
+        return lo;
+    }
+    std::optional<size_t> insert(const DataPoint& point) {
+        size_t pos = lower_index(point.timestamp + 1);
+        if (pos == 0 && size == MAX_POINTS) return std::nullopt;
+        if (size == MAX_POINTS) --pos;
+        push(point);
+        for (size_t i = size - 1; i > pos; --i) {
+            size_t a = (head + MAX_POINTS - size + i) % MAX_POINTS;
+            size_t b = (head + MAX_POINTS - size + i - 1) % MAX_POINTS;
+            std::swap(buffer[a], buffer[b]);
         }
+        return pos;
     }
-    ~SerialPort() { if (fd != -1) close(fd); }
-    int get() const { return fd; }
-    void close_port() { if (fd != -1) { close(fd); fd = -1; } }
 };
 
-class X11Display {
-    Display* dpy = nullptr;
-    Window win = 0;
-    GC gc = 0;
-    Pixmap pixmap = 0;
+class MatrixProfile {
+    struct Partial {
+        std::vector<double> corr;
+        std::vector<int> index;
+    };
 
-    void cleanup() {
-        if (pixmap) { XFreePixmap(dpy, pixmap); pixmap = 0; }
-        if (gc) { XFreeGC(dpy, gc); gc = 0; }
-        if (win) { XDestroyWindow(dpy, win); win = 0; }
-        if (dpy) { XCloseDisplay(dpy); dpy = nullptr; }
+    std::vector<float> profile;
+    std::vector<int> profile_index;
+    int window = 0;
+
+    static void compute_block(const std::vector<double>& series, const std::vector<double>& mean,
+                              const std::vector<double>& inv_std, int m, int first_diag, Partial& out) {
+        int n_sub = static_cast<int>(mean.size());
+        int lanes = std::min(MP_LANES, n_sub - first_diag);
+        double qt[MP_LANES] = {0.0};
+        double corr[MP_LANES];
+        for (int i = 0; i + first_diag < n_sub; ++i) {
+            int j0 = i + first_diag;
+            int active = std::min(lanes, n_sub - j0);
+            if (i % 4096 == 0) {
+                for (int l = 0; l < active; ++l) {
+                    double dot = 0.0;
+                    for (int t = 0; t < m; ++t) dot += series[i + t] * series[j0 + l + t];
+                    qt[l] = dot;
+                }
+            } else {
+                double drop = series[i - 1], add = series[i + m - 1];
+                for (int l = 0; l < active; ++l)
+                    qt[l] += add * series[j0 + l + m - 1] - drop * series[j0 + l - 1];
+            }
+            // A constant window (inv_std 0) matches another constant one exactly and is as far as possible
+            // from any other window, instead of landing at the mid-range distance sqrt(2m).
+            for (int l = 0; l < active; ++l) {
+                double inv_j = inv_std[j0 + l];
+                corr[l] = inv_std[i] == 0.0 || inv_j == 0.0 ? (inv_std[i] == inv_j ? 1.0 : -1.0)
+                                                            : (qt[l] - m * mean[i] * mean[j0 + l]) * inv_std[i] * inv_j / m;
+            }
+            for (int l = 0; l < active; ++l) {
+                if (corr[l] > out.corr[i]) {
+                    out.corr[i] = corr[l];
+                    out.index[i] = j0 + l;
+                }
+                if (corr[l] > out.corr[j0 + l]) {
+                    out.corr[j0 + l] = corr[l];
+                    out.index[j0 + l] = i;
+                }
+            }
+        }
     }
 
+    bool overlaps(int a, int b) const { return std::abs(a - b) < window; }
+
 public:
-    X11Display() {
-        dpy = XOpenDisplay(nullptr);
-        if (!dpy) throw std::runtime_error("Cannot open display");
+    void compute(const std::vector<float>& values, int m, unsigned threads = 0) {
+        window = m;
+        profile.clear();
+        profile_index.clear();
+        int n = static_cast<int>(values.size());
+        if (m < 4 || n < 2 * m) return;
 
-        int screen = DefaultScreen(dpy);
-        win = XCreateSimpleWindow(dpy, RootWindow(dpy, screen), 10, 10, WIDTH, HEIGHT, 1,
-                                  BlackPixel(dpy, screen), WhitePixel(dpy, screen));
-        XStoreName(dpy, win, "BMP280 Sensor Monitor");
+        int n_sub = n - m + 1;
+        double center = 0.0;
+        for (float v : values) center += v;
+        center /= n;
+        std::vector<double> series(n);
+        for (int i = 0; i < n; ++i) series[i] = values[i] - center;
 
-        XWMHints* wm_hints = XAllocWMHints();
-        if (wm_hints) {
-            wm_hints->flags = StateHint;
-            wm_hints->initial_state = NormalState;
-            XSetWMHints(dpy, win, wm_hints);
-            XFree(wm_hints);
+        std::vector<double> mean(n_sub), inv_std(n_sub);
+        for (int i = 0; i < n_sub; ++i) {
+            double sum = 0.0, sum_sq = 0.0;
+            for (int t = 0; t < m; ++t) {
+                sum += series[i + t];
+                sum_sq += series[i + t] * series[i + t];
+            }
+            double mu = sum / m;
+            double var = sum_sq / m - mu * mu;
+            mean[i] = mu;
+            inv_std[i] = var > 1e-12 ? 1.0 / std::sqrt(var) : 0.0;
         }
 
-        XSelectInput(dpy, win, ExposureMask | KeyPressMask | ButtonPressMask | ButtonReleaseMask | PointerMotionMask);
-        XMapWindow(dpy, win);
-        gc = XCreateGC(dpy, win, 0, nullptr);
-        XSetForeground(dpy, gc, BlackPixel(dpy, screen));
+        unsigned workers = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+        int exclusion = std::max(1, m / 4);
+        std::atomic<int> next_diag{exclusion};
+        std::vector<Partial> partials(workers, Partial{std::vector<double>(n_sub, -2.0), std::vector<int>(n_sub, -1)});
+        auto worker = [&](Partial& part) {
+            int k;
+            while ((k = next_diag.fetch_add(MP_LANES)) < n_sub)
+                compute_block(series, mean, inv_std, m, k, part);
+        };
+        std::vector<std::thread> pool;
+        for (unsigned w = 1; w < workers; ++w) pool.emplace_back(worker, std::ref(partials[w]));
+        worker(partials[0]);
+        for (auto& t : pool) t.join();
 
-        pixmap = XCreatePixmap(dpy, win, WIDTH, HEIGHT, DefaultDepth(dpy, screen));
-        XSetForeground(dpy, gc, WhitePixel(dpy, screen));
-        XFillRectangle(dpy, pixmap, gc, 0, 0, WIDTH, HEIGHT);
+        profile.assign(n_sub, std::numeric_limits<float>::infinity());
+        profile_index.assign(n_sub, -1);
+        for (int i = 0; i < n_sub; ++i) {
+            double best = -2.0;
+            for (const auto& part : partials) {
+                if (part.index[i] >= 0 && part.corr[i] > best) {
+                    best = part.corr[i];
+                    profile_index[i] = part.index[i];
+                }
+            }
+            if (profile_index[i] >= 0)
+                profile[i] = static_cast<float>(std::sqrt(std::max(0.0, 2.0 * m * (1.0 - std::min(best, 1.0)))));
+        }
     }
-    ~X11Display() { cleanup(); }
-    X11Display(const X11Display&) = delete;
-    X11Display& operator=(const X11Display&) = delete;
-    Display* get_display() const { return dpy; }
-    Window get_window() const { return win; }
-    GC get_gc() const { return gc; }
-    Pixmap get_pixmap() const { return pixmap; }
-    void set_background(unsigned long color) {
-        XSetWindowBackground(dpy, win, color);
-        XSetForeground(dpy, gc, color);
-        XFillRectangle(dpy, pixmap, gc, 0, 0, WIDTH, HEIGHT);
-        XClearWindow(dpy, win);
+
+    std::vector<std::pair<int, int>> top_motifs(int k) const {
+        std::vector<int> order(profile.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = static_cast<int>(i);
+        std::sort(order.begin(), order.end(), [this](int a, int b) { return profile[a] < profile[b]; });
+        std::vector<std::pair<int, int>> motifs;
+        for (int i : order) {
+            if (static_cast<int>(motifs.size()) >= k) break;
+            int j = profile_index[i];
+            if (j < 0 || !std::isfinite(profile[i])) continue;
+            bool taken = false;
+            for (const auto& [a, b] : motifs) {
+                if (overlaps(i, a) || overlaps(i, b) || overlaps(j, a) || overlaps(j, b)) {
+                    taken = true;
+                    break;
+                }
+            }
+            if (!taken) motifs.emplace_back(std::min(i, j), std::max(i, j));
+        }
+        return motifs;
     }
-    void copy_pixmap_to_window() {
-        XCopyArea(dpy, pixmap, win, gc, 0, 0, WIDTH, HEIGHT, 0, 0);
-        XFlush(dpy);
+
+    std::vector<int> top_discords(int k) const {
+        std::vector<int> order(profile.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = static_cast<int>(i);
+        std::sort(order.begin(), order.end(), [this](int a, int b) { return profile[a] > profile[b]; });
+        std::vector<int> discords;
+        for (int i : order) {
+            if (static_cast<int>(discords.size()) >= k) break;
+            if (!std::isfinite(profile[i])) continue;
+            if (std::none_of(discords.begin(), discords.end(), [&](int d) { return overlaps(i, d); }))
+                discords.push_back(i);
+        }
+        return discords;
     }
-};
 
-struct Config {
-    speed_t baud_rate = B9600;
-    int save_interval = 30;
-    char csv_delimiter = ',';
-    float temp_range[2] = {-40.0f, 85.0f};
-    float press_range[2] = {300.0f, 1100.0f};
-    std::string menu_bg_color = "#808080";
-    std::string help_bg_color = "#D3D3D3";
-    std::array<std::string, 4> graph_colors = {"blue", "red", "green", "yellow"};
+    float distance(int i) const { return profile[i]; }
+    size_t get_size() const { return profile.size(); }
 };
 
-struct GuiState {
-    float zoom_temp, zoom_press, vzoom_temp, vzoom_press;
-    int offset_temp, offset_press;
-    int theme;
-    bool show_help, paused;
-    int selected_help_item;
-    size_t history_size;
-
-    bool operator!=(const GuiState& other) const {
-        return zoom_temp != other.zoom_temp || zoom_press != other.zoom_press ||
-               vzoom_temp != other.vzoom_temp || vzoom_press != other.vzoom_press ||
-               offset_temp != other.offset_temp || offset_press != other.offset_press ||
-               theme != other.theme || show_help != other.show_help ||
-               paused != other.paused || selected_help_item != other.selected_help_item ||
-               history_size != other.history_size;
+std::vector<Annotation> annotate_motifs(const std::vector<DataPoint>& points, bool is_temp,
+                                        int window, int top_k, unsigned threads = 0) {
+    std::vector<float> values;
+    values.reserve(points.size());
+    for (const auto& p : points) values.push_back(is_temp ? p.temperature : p.pressure);
+
+    MatrixProfile mp;
+    mp.compute(values, window, threads);
+    std::vector<Annotation> annotations;
+    if (mp.get_size() == 0) return annotations;
+
+    int rank = 1;
+    for (const auto& [a, b] : mp.top_motifs(top_k)) {
+        for (int i : {a, b})
+            annotations.push_back({points[i].timestamp, points[i + window - 1].timestamp, is_temp, true, rank, mp.distance(a)});
+        ++rank;
+    }
+    rank = 1;
+    for (int i : mp.top_discords(top_k))
+        annotations.push_back({points[i].timestamp, points[i + window - 1].timestamp, is_temp, false, rank++, mp.distance(i)});
+    return annotations;
+}
+
+std::string format_time(time_t t) {
+    char buf[32];
+    strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", localtime(&t));
+    return buf;
+}
+
+bool parse_log_line(const std::string& line, DataPoint& point) {
+    std::istringstream iss(line);
+    char delim;
+    return static_cast<bool>(iss >> point.temperature >> delim >> point.pressure >> delim >> point.timestamp);
+}
+
+class LogReader {
+    std::ifstream in;
+    std::string path;
+    time_t last_timestamp = 0;
+    size_t out_of_order = 0;
+
+public:
+    explicit LogReader(const std::string& file) : in(file), path(file) {
+        if (!in) throw std::runtime_error("Failed to open data file: " + file);
+    }
+
+    bool next(DataPoint& point) {
+        std::string line;
+        while (std::getline(in, line)) {
+            if (!parse_log_line(line, point)) continue;
+            if (point.timestamp < last_timestamp) {
+                ++out_of_order;
+                continue;
+            }
+            last_timestamp = point.timestamp;
+            return true;
+        }
+        return false;
     }
+
+    size_t get_out_of_order() const { return out_of_order; }
+    const std::string& get_path() const { return path; }
 };
 
-class BMP280Gui {
-private:
-    enum class Theme { White, Dark, HighContrast };
+class LogMerger {
+    struct Head {
+        DataPoint point;
+        size_t reader;
+        bool operator>(const Head& other) const {
+            return point.timestamp != other.point.timestamp ? point.timestamp > other.point.timestamp
+                                                            : reader > other.reader;
+        }
+    };
 
-    std::unique_ptr<X11Display> x11;
-    Display* dpy;
-    Window win;
-    GC gc;
-    Pixmap pixmap;
-    Window menu_win;
-    GC menu_gc;
-    std::unique_ptr<SerialPort> serial;
-    int fd;
-    CircularBuffer history;
-    std::string filename;
-    time_t last_save;
-    std::array<unsigned long, 4> colors;
-    unsigned long background_color;
-    unsigned long text_color;
-    unsigned long menu_bg_color;
-    unsigned long menu_text_color;
-    unsigned long menu_highlight_color;
-    unsigned long help_bg_color;
-    unsigned long keybind_color;
-    Theme theme = Theme::White;
-    float zoom_temp = 1.0f, zoom_press = 1.0f;
-    float vzoom_temp = 1.0f, vzoom_press = 1.0f;
-    int offset_temp = 0, offset_press = 0;
-    mutable std::vector<std::string> error_messages;
-    mutable std::vector<std::string> persistent_errors;
-    mutable time_t last_error_time = 0;
-    time_t last_reconnect_attempt = 0;
-    int reconnect_attempts = 0;
-    time_t menu_highlight_time = 0;
-    float temp_range[2] = {-40.0f, 85.0f};
-    float press_range[2] = {300.0f, 1100.0f};
-    float default_temp_range[2] = {-40.0f, 85.0f};
-    float default_press_range[2] = {300.0f, 1100.0f};
-    speed_t baud_rate = B9600;
-    int save_interval = 30;
-    char csv_delimiter = ',';
-    bool paused = false;
-    bool window_mapped = false;
-    bool show_help = false;
-    int selected_help_item = -1;
-    bool dragging = false;
-    int drag_start_x = 0;
-    bool needs_redraw = false;
-    bool menu_needs_redraw = false;
-    char serial_buffer[BUFFER_SIZE] = {0};
-    size_t serial_buf_pos = 0;
-    XFontStruct* regular_font = nullptr;
-    XFontStruct* bold_font = nullptr;
-    mutable unsigned long current_fg = 0;
-
-    static constexpr std::array<std::string_view, 11> help_lines = {
-        "Keyboard Shortcuts:",
-        "q: Quit",
-        "s: Save data to file",
-        "p: Pause/Resume",
-        "c: Clear errors",
-        "b: Change baud rate",
-        "+/-: Horizontal zoom in/out",
-        "Up/Down: Vertical zoom in/out",
-        "Left/Right: Scroll graph",
-        "t: Toggle theme",
-        "h: Show/hide this help"
+    std::vector<std::unique_ptr<LogReader>> readers;
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heap;
+    struct Written {
+        Head head;
+        std::vector<size_t> matched_by;
     };
-    static constexpr int max_reconnect_attempts = 10;
 
-    static int x11_error_handler(Display* dpy, XErrorEvent* err) {
-        char err_msg[256];
-        XGetErrorText(dpy, err->error_code, err_msg, sizeof(err_msg));
-        std::ofstream log("logs/errors.log", std::ios::app);
-        if (log) {
-            time_t now = time(nullptr);
-            log << std::ctime(&now) << ": X11 error: " << err_msg << "\n";
-        }
-        std::cerr << "X11 error: " << err_msg << "\n";
-        if (err->error_code == BadWindow || err->error_code == BadDrawable) {
-            throw std::runtime_error("Critical X11 error: " + std::string(err_msg));
+    std::deque<Written> recent;
+    time_t tolerance;
+    float epsilon;
+    size_t read_count = 0;
+    size_t duplicates = 0;
+
+    // A sample duplicates the closest written sample from another input that no earlier sample of its
+    // own input has matched; consecutive samples of one log are never duplicates of each other.
+    bool is_duplicate(const Head& h) {
+        Written* best = nullptr;
+        for (auto& w : recent) {
+            const DataPoint& r = w.head.point;
+            if (w.head.reader == h.reader || std::abs(h.point.temperature - r.temperature) > epsilon ||
+                std::abs(h.point.pressure - r.pressure) > epsilon ||
+                std::find(w.matched_by.begin(), w.matched_by.end(), h.reader) != w.matched_by.end())
+                continue;
+            if (!best || std::abs(h.point.timestamp - r.timestamp) < std::abs(h.point.timestamp - best->head.point.timestamp))
+                best = &w;
         }
-        return 0;
+        if (best) best->matched_by.push_back(h.reader);
+        return best != nullptr;
     }
 
-    void add_error(const std::string& msg, bool persistent = false) const {
-        if (error_messages.size() >= 5) error_messages.erase(error_messages.begin());
-        error_messages.push_back(msg);
-        if (persistent) {
-            if (persistent_errors.size() >= 5) persistent_errors.erase(persistent_errors.begin());
-            persistent_errors.push_back(msg);
+public:
+    LogMerger(const std::vector<std::string>& paths, time_t tolerance_seconds, float value_epsilon)
+        : tolerance(tolerance_seconds), epsilon(value_epsilon) {
+        for (const auto& path : paths) readers.push_back(std::make_unique<LogReader>(path));
+        for (size_t i = 0; i < readers.size(); ++i) {
+            DataPoint p;
+            if (readers[i]->next(p)) heap.push({p, i});
         }
-        last_error_time = time(nullptr);
-        std::ofstream log("logs/errors.log", std::ios::app);
-        if (log) log << std::ctime(&last_error_time) << ": " << msg << "\n";
     }
 
-    std::optional<std::string> find_serial_port() const {
-        static const char* prefixes[] = {"/dev/ttyACM", "/dev/ttyUSB"};
-        for (const auto* prefix : prefixes) {
-            for (int i = 0; i < 10; ++i) {
-                std::string port = std::string(prefix) + std::to_string(i);
-                if (std::filesystem::exists(port)) return port;
+    bool next(DataPoint& point) {
+        while (!heap.empty()) {
+            Head head = heap.top();
+            heap.pop();
+            ++read_count;
+            DataPoint p;
+            if (readers[head.reader]->next(p)) heap.push({p, head.reader});
+
+            while (!recent.empty() && recent.front().head.point.timestamp + tolerance < head.point.timestamp) recent.pop_front();
+            if (is_duplicate(head)) {
+                ++duplicates;
+                continue;
             }
+            recent.push_back({head, {}});
+            point = head.point;
+            return true;
         }
-        return std::nullopt;
+        return false;
     }
 
-    bool open_serial(const std::string& port, speed_t baud) {
-        try {
-            serial = std::make_unique<SerialPort>(port, baud);
-            fd = serial->get();
-            return true;
-        } catch (const std::exception& e) {
-            add_error(e.what(), true);
-            fd = -1;
-            return false;
-        }
+    size_t get_read_count() const { return read_count; }
+    size_t get_duplicates() const { return duplicates; }
+    size_t get_out_of_order() const {
+        size_t total = 0;
+        for (const auto& r : readers) total += r->get_out_of_order();
+        return total;
     }
+};
 
-    void try_reconnect() {
-        if (fd != -1 || reconnect_attempts >= max_reconnect_attempts) return;
-        if (difftime(time(nullptr), last_reconnect_attempt) < RECONNECT_TIMEOUT) return;
-        last_reconnect_attempt = time(nullptr);
-        reconnect_attempts++;
+enum class ResampleMode { Last, Linear, Mean };
 
-        auto port = find_serial_port();
-        if (!port) {
-            add_error("No serial port available", true);
-            return;
-        }
+struct AlignedBlock {
+    std::vector<time_t> timestamps;
+    std::vector<std::vector<float>> columns;
+};
 
-        speed_t baud_rates[] = {B9600, B115200};
-        for (speed_t baud : baud_rates) {
-            if (open_serial(*port, baud)) {
-                baud_rate = baud;
-                std::cout << "Reconnected to " << *port << " at baud rate " << (baud == B9600 ? 9600 : 115200) << "\n";
-                persistent_errors.clear();
-                error_messages.clear();
-                reconnect_attempts = 0;
-                return;
+class Resampler {
+    struct Channel {
+        std::deque<std::pair<time_t, float>> pending;
+        std::optional<std::pair<time_t, float>> prev;
+        time_t latest = 0;
+        bool seen = false;
+    };
+
+    std::vector<Channel> channels;
+    ResampleMode mode;
+    time_t step;
+    time_t max_lookahead;
+    time_t cursor = 0;
+    time_t watermark = 0;
+    bool started = false;
+
+    bool resolved(const Channel& c, time_t g) const {
+        if (!c.seen) return false;
+        return mode == ResampleMode::Mean ? c.latest >= g + step : c.latest > g;
+    }
+
+    float take(Channel& c, time_t g) {
+        const float nan = std::numeric_limits<float>::quiet_NaN();
+        if (mode == ResampleMode::Mean) {
+            double sum = 0.0;
+            int count = 0;
+            while (!c.pending.empty() && c.pending.front().first < g + step) {
+                if (c.pending.front().first >= g) {
+                    sum += c.pending.front().second;
+                    ++count;
+                }
+                c.prev = c.pending.front();
+                c.pending.pop_front();
             }
+            return count > 0 ? static_cast<float>(sum / count) : nan;
         }
-        add_error("Failed to reconnect to " + *port + " with any baud rate", true);
+        while (!c.pending.empty() && c.pending.front().first <= g) {
+            c.prev = c.pending.front();
+            c.pending.pop_front();
+        }
+        if (!c.prev) return nan;
+        if (mode == ResampleMode::Last || c.prev->first == g || c.pending.empty()) return c.prev->second;
+        const auto& [t0, v0] = *c.prev;
+        const auto& [t1, v1] = c.pending.front();
+        return v0 + (v1 - v0) * static_cast<float>(g - t0) / static_cast<float>(t1 - t0);
     }
 
-    bool parse_value(const std::string& line, float& value) const {
-        size_t pos = line.find_first_of("-0123456789");
-        if (pos == std::string::npos) return false;
-        try {
-            value = std::stof(line.substr(pos));
-            return true;
-        } catch (const std::exception&) {
-            return false;
+public:
+    Resampler(size_t channel_count, time_t step_seconds, ResampleMode resample_mode, time_t lookahead)
+        : channels(channel_count), mode(resample_mode), step(std::max<time_t>(1, step_seconds)),
+          max_lookahead(std::max<time_t>(0, lookahead)) {}
+
+    void push(size_t channel, time_t t, float value) {
+        if (channel >= channels.size()) return;
+        if (!started) {
+            cursor = t - t % step;
+            started = true;
         }
+        auto& c = channels[channel];
+        if (c.seen && t < c.latest) return;
+        c.pending.emplace_back(t, value);
+        c.latest = t;
+        c.seen = true;
+        watermark = std::max(watermark, t);
     }
 
-    void process_line(const std::string& line, float& temp, float& press, bool& got_temp, bool& got_press) {
-        float value;
-        if (line.find("Temp") != std::string::npos && parse_value(line, value)) {
-            if (value >= -40.0f && value <= 85.0f) {
-                temp = value;
-                got_temp = true;
-            } else {
-                add_error("Invalid temperature: " + std::to_string(value));
-            }
-        } else if (line.find("Pres") != std::string::npos && parse_value(line, value)) {
-            if (value >= 300.0f && value <= 1100.0f) {
-                press = value;
-                got_press = true;
-            } else {
-                add_error("Invalid pressure: " + std::to_string(value));
-            }
+    size_t pop(AlignedBlock& block, bool flush = false) {
+        block.timestamps.clear();
+        block.columns.assign(channels.size(), {});
+        if (!started) return 0;
+        while (true) {
+            bool forced = cursor + step + max_lookahead <= watermark || (flush && cursor <= watermark);
+            if (!forced && !std::all_of(channels.begin(), channels.end(),
+                                        [&](const Channel& c) { return resolved(c, cursor); })) break;
+            block.timestamps.push_back(cursor);
+            for (size_t i = 0; i < channels.size(); ++i) block.columns[i].push_back(take(channels[i], cursor));
+            cursor += step;
         }
+        return block.timestamps.size();
     }
 
-    void read_serial() {
-        if (fd == -1 || paused) return;
+    static std::optional<ResampleMode> parse_mode(const std::string& name) {
+        if (name == "last") return ResampleMode::Last;
+        if (name == "linear") return ResampleMode::Linear;
+        if (name == "mean") return ResampleMode::Mean;
+        return std::nullopt;
+    }
+};
 
-        fd_set set;
-        struct timeval timeout = {0, 100000};
-        FD_ZERO(&set);
-        FD_SET(fd, &set);
+class SlidingWindowStats {
+    struct Sample {
+        time_t t;
+        std::array<float, 2> v;
+    };
 
-        int ready = select(fd + 1, &set, nullptr, nullptr, &timeout);
-        if (ready < 0) {
-            add_error("Select error: " + std::string(strerror(errno)));
-            serial->close_port();
-            fd = -1;
-            return;
-        }
-        if (ready == 0) return;
+    std::deque<Sample> samples;
+    std::array<std::deque<uint64_t>, 2> min_q, max_q;
+    uint64_t first_seq = 0;
+    std::array<double, 2> sum = {0.0, 0.0};
+    std::array<double, 2> integral = {0.0, 0.0};
+    double duration = 0.0;
+    time_t window;
+    IntegralMethod method;
 
-        int len = read(fd, serial_buffer + serial_buf_pos, BUFFER_SIZE - serial_buf_pos - 1);
-        if (len < 0 && errno != EAGAIN) {
-            add_error("Serial read error: " + std::string(strerror(errno)));
-            serial->close_port();
-            fd = -1;
-            return;
-        }
-        if (len <= 0) return;
+    const Sample& at(uint64_t seq) const { return samples[seq - first_seq]; }
 
-        serial_buffer[serial_buf_pos + len] = '\0';
-        std::string buf(serial_buffer, serial_buf_pos + len);
-        size_t pos = 0;
-        float temp = 0.0f, press = 0.0f;
-        bool got_temp = false, got_press = false;
+    double span(const Sample& a, const Sample& b) const {
+        double seconds = difftime(b.t, a.t);
+        return seconds > TW_MAX_GAP ? 0.0 : seconds;
+    }
 
-        while (pos < buf.size()) {
-            size_t nl = buf.find('\n', pos);
-            if (nl == std::string::npos) break;
-            std::string line = buf.substr(pos, nl - pos);
-            pos = nl + 1;
-            process_line(line, temp, press, got_temp, got_press);
+    // Adds the sample at seq to a monotonic queue whose later entries are already in place: earlier
+    // entries it dominates are dropped, and it is kept only if it beats everything after it.
+    template <typename Better>
+    void enqueue_at(std::deque<uint64_t>& q, uint64_t seq, int ch, Better better) {
+        float v = at(seq).v[ch];
+        auto pos = std::lower_bound(q.begin(), q.end(), seq);
+        auto keep = pos;
+        while (keep != q.begin() && !better(at(*std::prev(keep)).v[ch], v)) --keep;
+        pos = q.erase(keep, pos);
+        if (pos == q.end() || better(v, at(*pos).v[ch])) q.insert(pos, seq);
+    }
+
+public:
+    SlidingWindowStats(time_t window_seconds, IntegralMethod integral_method)
+        : window(window_seconds), method(integral_method) {}
+
+    void push(time_t t, float temp, float press) {
+        if (!samples.empty() && t < samples.back().t) return;
+        Sample s{t, {temp, press}};
+        uint64_t seq = first_seq + samples.size();
+        if (!samples.empty()) {
+            const auto& prev = samples.back();
+            for (int ch = 0; ch < 2; ++ch)
+                integral[ch] += segment_integral(prev.v[ch], s.v[ch], difftime(t, prev.t), method);
+            duration += span(prev, s);
+        }
+        samples.push_back(s);
+        for (int ch = 0; ch < 2; ++ch) {
+            sum[ch] += s.v[ch];
+            while (!min_q[ch].empty() && at(min_q[ch].back()).v[ch] >= s.v[ch]) min_q[ch].pop_back();
+            min_q[ch].push_back(seq);
+            while (!max_q[ch].empty() && at(max_q[ch].back()).v[ch] <= s.v[ch]) max_q[ch].pop_back();
+            max_q[ch].push_back(seq);
         }
+    }
 
-        if (got_temp && got_press) {
-            history.push({temp, press, time(nullptr)});
-            log_data();
+    void insert(time_t t, float temp, float press) {
+        if (samples.empty() || t >= samples.back().t) {
+            push(t, temp, press);
+            return;
         }
+        Sample s{t, {temp, press}};
+        size_t k = std::upper_bound(samples.begin(), samples.end(), t,
+                                    [](time_t t, const Sample& s) { return t < s.t; }) - samples.begin();
+        const Sample& next = samples[k];
+        for (int ch = 0; ch < 2; ++ch) {
+            sum[ch] += s.v[ch];
+            integral[ch] += segment_integral(s.v[ch], next.v[ch], difftime(next.t, t), method);
+        }
+        duration += span(s, next);
+        if (k > 0) {
+            const Sample& prev = samples[k - 1];
+            for (int ch = 0; ch < 2; ++ch)
+                integral[ch] += segment_integral(prev.v[ch], s.v[ch], difftime(t, prev.t), method) -
+                                segment_integral(prev.v[ch], next.v[ch], difftime(next.t, prev.t), method);
+            duration += span(prev, s) - span(prev, next);
+        }
+        samples.insert(samples.begin() + k, s);
+        uint64_t seq = first_seq + k;
+        for (int ch = 0; ch < 2; ++ch) {
+            for (auto* q : {&min_q[ch], &max_q[ch]})
+                for (auto it = q->rbegin(); it != q->rend() && *it >= seq; ++it) ++*it;
+            enqueue_at(min_q[ch], seq, ch, std::less<float>());
+            enqueue_at(max_q[ch], seq, ch, std::greater<float>());
+        }
+    }
 
-        serial_buf_pos = buf.size() - pos;
-        if (serial_buf_pos > 0) {
-            std::memmove(serial_buffer, buf.c_str() + pos, serial_buf_pos);
-            serial_buffer[serial_buf_pos] = '\0';
-        } else {
-            serial_buf_pos = 0;
+    void expire(time_t now) {
+        while (!samples.empty() && difftime(now, samples.front().t) > window) {
+            const auto& old = samples.front();
+            for (int ch = 0; ch < 2; ++ch) {
+                sum[ch] -= old.v[ch];
+                if (samples.size() > 1)
+                    integral[ch] -= segment_integral(old.v[ch], samples[1].v[ch], difftime(samples[1].t, old.t), method);
+                if (!min_q[ch].empty() && min_q[ch].front() == first_seq) min_q[ch].pop_front();
+                if (!max_q[ch].empty() && max_q[ch].front() == first_seq) max_q[ch].pop_front();
+            }
+            if (samples.size() > 1) duration -= span(old, samples[1]);
+            samples.pop_front();
+            ++first_seq;
+        }
+        if (samples.empty()) {
+            sum = {0.0, 0.0};
+            integral = {0.0, 0.0};
+            duration = 0.0;
         }
     }
 
-    void log_data() const {
-        if (history.get_size() == 0) return;
-        const auto& last = history[history.get_size() - 1];
-        float altitude = 44330.0f * (1.0f - std::pow(last.pressure / 1013.25f, 0.1903f));
-        std::cout << "Temp: " << last.temperature << " C, Press: " << last.pressure
-                  << " hPa, Alt: " << altitude << " m\n";
+    Aggregate get(int ch) const {
+        Aggregate agg;
+        if (samples.empty()) return agg;
+        agg.count = static_cast<int>(samples.size());
+        agg.sum = sum[ch];
+        agg.min = at(min_q[ch].front()).v[ch];
+        agg.max = at(max_q[ch].front()).v[ch];
+        agg.integral = integral[ch];
+        agg.duration = duration;
+        return agg;
     }
 
-    float compute_visible_average(bool is_temp, int start, int max_points) const {
-        if (history.get_size() == 0) return 0.0f;
-        float sum = 0.0f;
-        int count = 0;
-        for (int i = start; i < start + max_points && static_cast<size_t>(i) < history.get_size(); ++i) {
-            sum += is_temp ? history[i].temperature : history[i].pressure;
-            ++count;
+    void clear() {
+        samples.clear();
+        for (int ch = 0; ch < 2; ++ch) {
+            min_q[ch].clear();
+            max_q[ch].clear();
         }
-        return count > 0 ? sum / count : 0.0f;
+        first_seq = 0;
+        sum = {0.0, 0.0};
+        integral = {0.0, 0.0};
+        duration = 0.0;
     }
+    void set_method(IntegralMethod m) { method = m; }
 
-    void set_foreground(unsigned long color) const {
-        if (color != current_fg) {
-            XSetForeground(dpy, gc, color);
-            current_fg = color;
+    time_t last_timestamp() const { return samples.empty() ? 0 : samples.back().t; }
+
+    size_t memory_usage() const {
+        size_t bytes = samples.size() * sizeof(Sample);
+        for (int ch = 0; ch < 2; ++ch) bytes += (min_q[ch].size() + max_q[ch].size()) * sizeof(uint64_t);
+        return bytes;
+    }
+
+    void save(BinaryWriter& out) const {
+        out.put<uint64_t>(samples.size());
+        for (const auto& s : samples) out.put(s);
+    }
+    bool restore(BinaryReader& in) {
+        clear();
+        uint64_t n = in.get<uint64_t>();
+        for (uint64_t i = 0; i < n && in.good(); ++i) {
+            Sample s = in.get<Sample>();
+            push(s.t, s.v[0], s.v[1]);
         }
+        if (!in.good()) clear();
+        return in.good();
     }
+};
 
-    void draw_graph(int x, int y, int w, int h, bool is_temp, float threshold, unsigned long color_low, unsigned long color_high) const {
-        if (history.get_size() < 2) return;
+struct Envelope {
+    std::array<float, 2> min;
+    std::array<float, 2> max;
+    uint32_t count;
+};
 
-        float zoom = std::clamp(is_temp ? zoom_temp : zoom_press, 1.0f, 100.0f);
-        int offset = std::clamp(is_temp ? offset_temp : offset_press, 0, static_cast<int>(history.get_size()));
-        int max_points = static_cast<int>(MAX_POINTS / zoom);
-        int start = std::max(0, std::min(static_cast<int>(history.get_size()) - 2, static_cast<int>(history.get_size()) - max_points - offset));
+class Decimator {
+    double threshold_hz;
+    double rate_hz = 0.0;
+    time_t rate_second = 0;
+    uint32_t rate_count = 0;
+    std::optional<time_t> bucket;
+    std::array<Aggregate, 2> channels;
 
-        float vzoom = std::clamp(is_temp ? vzoom_temp : vzoom_press, 1.0f, 100.0f);
-        const float* default_range = is_temp ? default_temp_range : default_press_range;
-        float default_min = default_range[0];
-        float default_max = default_range[1];
-        float default_span = default_max - default_min;
+public:
+    explicit Decimator(double above_hz) : threshold_hz(above_hz) {}
 
-        float avg_val = compute_visible_average(is_temp, start, max_points);
-        float span = default_span / vzoom;
-        float min_val = avg_val - span / 2.0f;
-        float max_val = avg_val + span / 2.0f;
+    void set_threshold(double hz) { threshold_hz = hz; }
+    bool enabled() const { return threshold_hz > 0.0; }
+    bool active() const { return enabled() && rate_hz > threshold_hz; }
+    double rate() const { return rate_hz; }
 
-        if (min_val < default_min) {
-            min_val = default_min;
-            max_val = min_val + span;
+    // Passes samples through while the input rate is at or below the threshold; above it, collapses
+    // each second into one mean point plus its min/max envelope.
+    template <typename Emit>
+    void add(const DataPoint& p, Emit emit) {
+        if (p.timestamp > rate_second) {
+            if (rate_second != 0) rate_hz = rate_count / std::max(1.0, difftime(p.timestamp, rate_second));
+            rate_second = p.timestamp;
+            rate_count = 0;
         }
-        if (max_val > default_max) {
-            max_val = default_max;
-            min_val = max_val - span;
+        ++rate_count;
+        if (bucket && p.timestamp != *bucket) flush(emit);
+        if (!bucket && !active()) {
+            emit(p, Envelope{{p.temperature, p.pressure}, {p.temperature, p.pressure}, 1});
+            return;
         }
+        if (!bucket) bucket = p.timestamp;
+        channels[0].add_sample(p.temperature);
+        channels[1].add_sample(p.pressure);
+    }
 
-        set_foreground(theme == Theme::White ? 0xCCCCCC : 0x555555);
-        for (int i = 1; i < 5; ++i) {
-            int y_pos = y + i * h / 5;
-            XDrawLine(dpy, pixmap, gc, x, y_pos, x + w, y_pos);
-            int x_pos = x + i * w / 5;
-            XDrawLine(dpy, pixmap, gc, x_pos, y, x_pos, y + h);
-        }
+    template <typename Emit>
+    void flush(Emit emit) {
+        if (!bucket) return;
+        emit(DataPoint{channels[0].mean(), channels[1].mean(), *bucket},
+             Envelope{{channels[0].min, channels[1].min}, {channels[0].max, channels[1].max},
+                      static_cast<uint32_t>(channels[0].count)});
+        bucket.reset();
+        channels = {};
+    }
+};
 
-        set_foreground(text_color);
-        XDrawRectangle(dpy, pixmap, gc, x, y, w, h);
+class RangeIndex {
+    struct Entry {
+        time_t t;
+        std::array<float, 2> v;
+    };
 
-        for (int i = 1; i < max_points && static_cast<size_t>(start + i) < history.get_size(); ++i) {
-            float val0 = history.smooth_value(is_temp, start + i - 1);
-            float val1 = history.smooth_value(is_temp, start + i);
-            int x0 = x + (i - 1) * w / max_points;
-            int x1 = x + i * w / max_points;
-            int y0 = y + h - static_cast<int>((val0 - min_val) / (max_val - min_val) * h);
-            int y1 = y + h - static_cast<int>((val1 - min_val) / (max_val - min_val) * h);
-            y0 = std::max(y, std::min(y + h, y0));
-            y1 = std::max(y, std::min(y + h, y1));
-            set_foreground(is_temp ? (val1 > threshold ? color_high : color_low)
-                                  : (std::abs(val1 - val0) > 1.0f ? color_high : color_low));
-            XDrawLine(dpy, pixmap, gc, x0, y0, x1, y1);
-        }
-
-        set_foreground(text_color);
-        for (int i = 0; i <= 5; ++i) {
-            float val = min_val + i * (max_val - min_val) / 5;
-            int y_pos = y + h - i * h / 5;
-            char label[32];
-            snprintf(label, sizeof(label), "%.0f %s", val, is_temp ? "C" : "hPa");
-            XDrawLine(dpy, pixmap, gc, x - 5, y_pos, x, y_pos);
-            XDrawString(dpy, pixmap, gc, x - 50, y_pos + 4, label, strlen(label));
+    // Sums for the least-squares slope and the variance, with time relative to some origin.
+    struct Moments {
+        double n = 0.0, t = 0.0, tt = 0.0;
+        std::array<double, 2> x{}, xx{}, tx{};
+
+        void add(double dt, const std::array<float, 2>& v, const std::array<float, 2>& base) {
+            n += 1.0;
+            t += dt;
+            tt += dt * dt;
+            for (int ch = 0; ch < 2; ++ch) {
+                double d = v[ch] - base[ch];
+                x[ch] += d;
+                xx[ch] += d * d;
+                tx[ch] += dt * d;
+            }
+        }
+        Moments& operator+=(const Moments& o) {
+            n += o.n;
+            t += o.t;
+            tt += o.tt;
+            for (int ch = 0; ch < 2; ++ch) {
+                x[ch] += o.x[ch];
+                xx[ch] += o.xx[ch];
+                tx[ch] += o.tx[ch];
+            }
+            return *this;
         }
+        Moments operator-(const Moments& o) const {
+            Moments m = *this;
+            m.n -= o.n;
+            m.t -= o.t;
+            m.tt -= o.tt;
+            for (int ch = 0; ch < 2; ++ch) {
+                m.x[ch] -= o.x[ch];
+                m.xx[ch] -= o.xx[ch];
+                m.tx[ch] -= o.tx[ch];
+            }
+            return m;
+        }
+        // The same sums with time measured from an origin d seconds earlier.
+        Moments shifted(double d) const {
+            Moments m = *this;
+            m.t += n * d;
+            m.tt += 2.0 * d * t + n * d * d;
+            for (int ch = 0; ch < 2; ++ch) m.tx[ch] += d * x[ch];
+            return m;
+        }
+    };
 
-        if (history.get_size() >= 2) {
-            time_t start_time = history[start].timestamp;
-            time_t end_time = history[std::min(static_cast<size_t>(start + max_points - 1), history.get_size() - 1)].timestamp;
-            for (int i = 0; i <= 5; ++i) {
-                int x_pos = x + i * w / 5;
-                time_t t = start_time + (end_time - start_time) * i / 5;
-                char time_str[16];
-                strftime(time_str, sizeof(time_str), "%H:%M:%S", localtime(&t));
-                XDrawString(dpy, pixmap, gc, x_pos - 20, y + h + 15, time_str, strlen(time_str));
+    std::vector<Entry> entries;
+    // block_moments[b]: running sums from the start of block b's RANGE_CHUNK-entry chunk through the end
+    // of block b, time relative to the chunk's first entry. chunk_prefix[c]: sums over chunks [0, c),
+    // time relative to the first entry. A query combines at most two partial blocks, two partial chunks
+    // and one prefix difference, each taken in its own frame, so short ranges late in the index keep
+    // their precision and the cost does not depend on the range's length.
+    std::vector<Moments> block_moments;
+    std::vector<Moments> chunk_prefix;
+    std::array<std::vector<std::vector<float>>, 2> sparse_min, sparse_max;
+    std::array<float, 2> base_v = {0.0f, 0.0f};
+    size_t capacity;
+    bool dropped = false;
+
+    void append_block(int ch, size_t block) {
+        size_t first = block * RANGE_BLOCK;
+        float lo = entries[first].v[ch], hi = lo;
+        for (size_t i = first + 1; i < first + RANGE_BLOCK; ++i) {
+            lo = std::min(lo, entries[i].v[ch]);
+            hi = std::max(hi, entries[i].v[ch]);
+        }
+        auto& mins = sparse_min[ch];
+        auto& maxs = sparse_max[ch];
+        if (mins.empty()) {
+            mins.emplace_back();
+            maxs.emplace_back();
+        }
+        mins[0].push_back(lo);
+        maxs[0].push_back(hi);
+        size_t blocks = mins[0].size();
+        for (size_t k = 1; (size_t(1) << k) <= blocks; ++k) {
+            if (mins.size() <= k) {
+                mins.emplace_back();
+                maxs.emplace_back();
             }
+            size_t i = blocks - (size_t(1) << k);
+            size_t half = size_t(1) << (k - 1);
+            mins[k].push_back(std::min(mins[k - 1][i], mins[k - 1][i + half]));
+            maxs[k].push_back(std::max(maxs[k - 1][i], maxs[k - 1][i + half]));
         }
+    }
 
-        set_foreground(text_color);
-        const char* label = is_temp ? "Temperature" : "Pressure";
-        XDrawString(dpy, pixmap, gc, x + 10, y + 15, label, strlen(label));
-        set_foreground(color_low);
-        XDrawLine(dpy, pixmap, gc, x + 100, y + 10, x + 120, y + 10);
-        if (is_temp) {
-            set_foreground(color_high);
-            XDrawLine(dpy, pixmap, gc, x + 130, y + 10, x + 150, y + 10);
+    void append(const Entry& e) {
+        if (entries.empty()) base_v = e.v;
+        entries.push_back(e);
+        if (entries.size() % RANGE_BLOCK) return;
+        size_t block = entries.size() / RANGE_BLOCK - 1, first = block * RANGE_BLOCK;
+        size_t chunk = first - first % RANGE_CHUNK;
+        Moments m = first > chunk ? block_moments.back() : Moments{};
+        for (size_t i = first; i < entries.size(); ++i) m.add(difftime(entries[i].t, entries[chunk].t), entries[i].v, base_v);
+        block_moments.push_back(m);
+        if (entries.size() % RANGE_CHUNK == 0) {
+            Moments prefix = chunk_prefix.back();
+            prefix += m.shifted(difftime(entries[chunk].t, entries[0].t));
+            chunk_prefix.push_back(prefix);
         }
+        for (int ch = 0; ch < 2; ++ch) append_block(ch, block);
     }
 
-    void draw_menu_bar() const {
-        XWindowAttributes attrs;
-        XGetWindowAttributes(dpy, menu_win, &attrs);
+    // Sums over [from, to), time relative to entries[origin].
+    Moments range_moments(size_t from, size_t to, size_t origin) const {
+        Moments m;
+        auto partial = [&](size_t a, size_t b) {
+            for (size_t i = a; i < b; ++i) m.add(difftime(entries[i].t, entries[origin].t), entries[i].v, base_v);
+        };
+        // Complete blocks [b1, b2) inside one chunk.
+        auto blocks = [&](size_t b1, size_t b2) {
+            if (b1 >= b2) return;
+            size_t chunk_block = b1 - b1 % (RANGE_CHUNK / RANGE_BLOCK);
+            Moments part = b1 > chunk_block ? block_moments[b2 - 1] - block_moments[b1 - 1] : block_moments[b2 - 1];
+            m += part.shifted(difftime(entries[chunk_block * RANGE_BLOCK].t, entries[origin].t));
+        };
+        size_t b1 = (from + RANGE_BLOCK - 1) / RANGE_BLOCK, b2 = to / RANGE_BLOCK;
+        if (b1 > b2) {
+            partial(from, to);
+            return m;
+        }
+        partial(from, b1 * RANGE_BLOCK);
+        partial(b2 * RANGE_BLOCK, to);
+        const size_t per_chunk = RANGE_CHUNK / RANGE_BLOCK;
+        size_t c1 = (b1 + per_chunk - 1) / per_chunk, c2 = b2 / per_chunk;
+        if (c1 > c2) {
+            blocks(b1, b2);
+            return m;
+        }
+        blocks(b1, c1 * per_chunk);
+        blocks(c2 * per_chunk, b2);
+        if (c2 > c1) m += (chunk_prefix[c2] - chunk_prefix[c1]).shifted(difftime(entries[0].t, entries[origin].t));
+        return m;
+    }
 
-        bool is_highlighted = difftime(time(nullptr), menu_highlight_time) <= HIGHLIGHT_DURATION;
-        XSetForeground(dpy, menu_gc, is_highlighted ? menu_highlight_color : menu_bg_color);
-        XFillRectangle(dpy, menu_win, menu_gc, 0, 0, attrs.width, attrs.height);
+    void rebuild(std::vector<Entry> kept) {
+        entries.clear();
+        block_moments.clear();
+        chunk_prefix.assign(1, Moments{});
+        for (int ch = 0; ch < 2; ++ch) {
+            sparse_min[ch].clear();
+            sparse_max[ch].clear();
+        }
+        for (const auto& e : kept) append(e);
+    }
 
-        std::stringstream ss;
-        ss << "File: " << filename << " | Interval: " << save_interval
-           << "s | Port: " << (fd != -1 ? "Connected" : "Disconnected")
-           << " | HZoom: " << std::fixed << std::setprecision(2) << zoom_temp
-           << " | VZoom: " << vzoom_temp
-           << " | Offset: " << offset_temp
-           << (paused ? " | Paused" : "")
-           << " | Theme: " << (theme == Theme::White ? "White" : theme == Theme::Dark ? "Dark" : "High-Contrast")
-           << " | Press 'h' for help";
-        std::string status = ss.str();
-        XSetForeground(dpy, menu_gc, menu_text_color);
-        XDrawString(dpy, menu_win, menu_gc, 10, 20, status.c_str(), status.length());
+    void truncate(size_t n) {
+        entries.resize(n);
+        block_moments.resize(n / RANGE_BLOCK);
+        chunk_prefix.resize(n / RANGE_CHUNK + 1);
+        size_t blocks = n / RANGE_BLOCK;
+        for (int ch = 0; ch < 2; ++ch) {
+            for (size_t k = 0; k < sparse_min[ch].size(); ++k) {
+                size_t keep = blocks >= (size_t(1) << k) ? blocks - (size_t(1) << k) + 1 : 0;
+                sparse_min[ch][k].resize(keep);
+                sparse_max[ch][k].resize(keep);
+            }
+            while (!sparse_min[ch].empty() && sparse_min[ch].back().empty()) {
+                sparse_min[ch].pop_back();
+                sparse_max[ch].pop_back();
+            }
+        }
     }
 
-    void save_data() {
-        std::filesystem::create_directory("logs");
-        std::string temp_path = "logs/" + filename + ".tmp";
-        std::ofstream out(temp_path);
-        if (!out) {
-            add_error("Failed to open temp file: " + temp_path);
-            return;
+    void scan(int ch, size_t from, size_t to, float& lo, float& hi) const {
+        for (size_t i = from; i < to; ++i) {
+            lo = std::min(lo, entries[i].v[ch]);
+            hi = std::max(hi, entries[i].v[ch]);
         }
-        for (size_t i = 0; i < history.get_size(); ++i) {
-            const auto& d = history[i];
-            out << d.temperature << csv_delimiter << d.pressure << csv_delimiter << d.timestamp << "\n";
+    }
+
+public:
+    explicit RangeIndex(size_t max_entries = RANGE_INDEX_CAPACITY) : capacity(max_entries) { rebuild({}); }
+
+    void push(const DataPoint& p) {
+        if (!entries.empty() && p.timestamp < entries.back().t) return;
+        if (entries.size() >= 2 * capacity) {
+            rebuild(std::vector<Entry>(entries.end() - capacity, entries.end()));
+            dropped = true;
         }
-        out.close();
-        if (out.fail()) {
-            add_error("Failed to write data to temp file");
+        append({p.timestamp, {p.temperature, p.pressure}});
+    }
+
+    void insert(const DataPoint& p) {
+        if (entries.empty() || p.timestamp >= entries.back().t) {
+            push(p);
             return;
         }
-        try {
-            std::filesystem::rename(temp_path, "logs/" + filename);
-            add_error("Saved to logs/" + filename);
-        } catch (const std::exception& e) {
-            add_error("Failed to rename temp file: " + std::string(e.what()));
+        auto it = std::upper_bound(entries.begin(), entries.end(), p.timestamp,
+                                   [](time_t t, const Entry& e) { return t < e.t; });
+        size_t pos = it - entries.begin();
+        std::vector<Entry> tail(it, entries.end());
+        tail.insert(tail.begin(), Entry{p.timestamp, {p.temperature, p.pressure}});
+        if (pos == 0) {
+            rebuild(std::move(tail));
+            return;
         }
+        truncate(pos);
+        for (const auto& e : tail) append(e);
     }
 
-    bool load_data(const std::string& path) {
-        if (!std::filesystem::exists(path)) return false;
+    // Raw samples on either side of t: prev is the last at or before t, next the first after it.
+    // Returns false when t falls before samples that were already dropped.
+    bool neighbours(time_t t, std::optional<DataPoint>& prev, std::optional<DataPoint>& next) const {
+        prev.reset();
+        next.reset();
+        auto it = std::upper_bound(entries.begin(), entries.end(), t,
+                                   [](time_t t, const Entry& e) { return t < e.t; });
+        if (it == entries.begin() && dropped) return false;
+        if (it != entries.begin()) prev = DataPoint{std::prev(it)->v[0], std::prev(it)->v[1], std::prev(it)->t};
+        if (it != entries.end()) next = DataPoint{it->v[0], it->v[1], it->t};
+        return true;
+    }
 
-        history.clear();
-        std::ifstream in(path);
-        if (!in) {
-            add_error("Failed to open data file: " + path);
-            return false;
+    void clear() {
+        rebuild({});
+        dropped = false;
+    }
+    size_t get_size() const { return entries.size(); }
+
+    bool trim(size_t keep) {
+        keep = std::max<size_t>(keep, RANGE_INDEX_MIN_KEEP);
+        if (entries.size() <= keep) return false;
+        rebuild(std::vector<Entry>(entries.end() - keep, entries.end()));
+        dropped = true;
+        capacity = keep;
+        entries.shrink_to_fit();
+        block_moments.shrink_to_fit();
+        chunk_prefix.shrink_to_fit();
+        for (int ch = 0; ch < 2; ++ch) {
+            for (auto& level : sparse_min[ch]) level.shrink_to_fit();
+            for (auto& level : sparse_max[ch]) level.shrink_to_fit();
         }
-        std::string line;
-        while (std::getline(in, line)) {
-            std::istringstream iss(line);
-            float t, p;
-            time_t ts;
-            char delim;
-            if (iss >> t >> delim >> p >> delim >> ts && delim == csv_delimiter &&
-                t >= -40.0f && t <= 85.0f && p >= 300.0f && p <= 1100.0f &&
-                ts > 0 && ts <= time(nullptr)) {
-                history.push({t, p, ts});
-            } else {
-                add_error("Invalid data line: " + line);
-            }
+        return true;
+    }
+
+    size_t memory_usage() const {
+        size_t bytes = entries.capacity() * sizeof(Entry) + (block_moments.capacity() + chunk_prefix.capacity()) * sizeof(Moments);
+        for (int ch = 0; ch < 2; ++ch) {
+            for (const auto& level : sparse_min[ch]) bytes += level.capacity() * sizeof(float);
+            for (const auto& level : sparse_max[ch]) bytes += level.capacity() * sizeof(float);
         }
-        return history.get_size() > 0;
+        return bytes;
     }
 
-    Statistics calculate_statistics() const {
-        Statistics stats = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0};
-        if (history.get_size() == 0) return stats;
+    RangeStats query(time_t from, time_t to, int ch) const {
+        RangeStats r = {0, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0};
+        if (from > to) std::swap(from, to);
+        auto cmp_lo = [](const Entry& e, time_t t) { return e.t < t; };
+        auto cmp_hi = [](time_t t, const Entry& e) { return t < e.t; };
+        size_t i = std::lower_bound(entries.begin(), entries.end(), from, cmp_lo) - entries.begin();
+        size_t j = std::upper_bound(entries.begin(), entries.end(), to, cmp_hi) - entries.begin();
+        if (i >= j) return r;
 
-        time_t now = time(nullptr);
-        float temp_sum = 0.0f, press_sum = 0.0f;
-        bool first = true;
+        Moments m = range_moments(i, j, i);
+        double n = m.n, st = m.t, stt = m.tt, sx = m.x[ch], sxx = m.xx[ch], stx = m.tx[ch];
+        double mean = sx / n;
+        double denom = n * stt - st * st;
 
-        for (size_t i = 0; i < history.get_size(); ++i) {
-            const auto& point = history[i];
-            if (difftime(now, point.timestamp) > STATS_WINDOW) continue;
+        r.count = static_cast<int>(j - i);
+        r.mean = static_cast<float>(base_v[ch] + mean);
+        r.stddev = static_cast<float>(std::sqrt(std::max(0.0, sxx / n - mean * mean)));
+        r.slope_per_hour = denom > 0.0 ? static_cast<float>((n * stx - st * sx) / denom * 3600.0) : 0.0f;
+        r.duration = difftime(entries[j - 1].t, entries[i].t);
 
-            if (first) {
-                stats.min_temp = stats.max_temp = point.temperature;
-                stats.min_press = stats.max_press = point.pressure;
-                first = false;
-            } else {
-                stats.min_temp = std::min(stats.min_temp, point.temperature);
-                stats.max_temp = std::max(stats.max_temp, point.temperature);
-                stats.min_press = std::min(stats.min_press, point.pressure);
-                stats.max_press = std::max(stats.max_press, point.pressure);
+        float lo = entries[i].v[ch], hi = lo;
+        size_t first_block = (i + RANGE_BLOCK - 1) / RANGE_BLOCK;
+        size_t last_block = j / RANGE_BLOCK;
+        if (first_block >= last_block) {
+            scan(ch, i, j, lo, hi);
+        } else {
+            scan(ch, i, first_block * RANGE_BLOCK, lo, hi);
+            scan(ch, last_block * RANGE_BLOCK, j, lo, hi);
+            size_t k = 0;
+            while ((size_t(2) << k) <= last_block - first_block) ++k;
+            const auto& mins = sparse_min[ch][k];
+            const auto& maxs = sparse_max[ch][k];
+            size_t tail = last_block - (size_t(1) << k);
+            lo = std::min({lo, mins[first_block], mins[tail]});
+            hi = std::max({hi, maxs[first_block], maxs[tail]});
+        }
+        r.min = lo;
+        r.max = hi;
+        return r;
+    }
+};
+
+enum class RollupLevel { Hour, Day, Month };
+
+const char* rollup_level_name(RollupLevel level) {
+    return level == RollupLevel::Hour ? "hour" : level == RollupLevel::Day ? "day" : "month";
+}
+
+time_t period_start(RollupLevel level, time_t t, int advance) {
+    tm parts{};
+    localtime_r(&t, &parts);
+    parts.tm_sec = 0;
+    parts.tm_min = 0;
+    if (level != RollupLevel::Hour) parts.tm_hour = 0;
+    if (level == RollupLevel::Month) parts.tm_mday = 1;
+    if (level == RollupLevel::Hour) parts.tm_hour += advance;
+    else if (level == RollupLevel::Day) parts.tm_mday += advance;
+    else parts.tm_mon += advance;
+    parts.tm_isdst = -1;
+    return mktime(&parts);
+}
+
+struct RollupBucket {
+    time_t start;
+    time_t end;
+    std::array<Aggregate, 2> channels;
+};
+
+class RollupStore {
+    struct Level {
+        RollupLevel level;
+        size_t retention;
+        std::deque<RollupBucket> closed;
+        std::optional<RollupBucket> open;
+    };
+
+    std::array<Level, 3> levels = {{{RollupLevel::Hour, 24 * 92, {}, std::nullopt},
+                                    {RollupLevel::Day, 366 * 3, {}, std::nullopt},
+                                    {RollupLevel::Month, 12 * 20, {}, std::nullopt}}};
+    std::optional<DataPoint> last;
+    IntegralMethod method;
+
+    RollupBucket& bucket_for(Level& lv, time_t t) {
+        if (!lv.open || t >= lv.open->end || t < lv.open->start) {
+            if (lv.open) {
+                lv.closed.push_back(*lv.open);
+                if (lv.closed.size() > lv.retention) lv.closed.pop_front();
             }
-            temp_sum += point.temperature;
-            press_sum += point.pressure;
-            stats.count++;
+            lv.open = RollupBucket{period_start(lv.level, t, 0), period_start(lv.level, t, 1), {}};
         }
+        return *lv.open;
+    }
+
+    RollupBucket* find_bucket(Level& lv, time_t t) {
+        if (lv.open && t >= lv.open->start && t < lv.open->end) return &*lv.open;
+        auto it = std::upper_bound(lv.closed.begin(), lv.closed.end(), t,
+                                   [](time_t t, const RollupBucket& b) { return t < b.start; });
+        if (it == lv.closed.begin()) return nullptr;
+        --it;
+        return t < it->end ? &*it : nullptr;
+    }
 
-        if (stats.count > 0) {
-            stats.avg_temp = temp_sum / stats.count;
-            stats.avg_press = press_sum / stats.count;
+    template <typename Lookup>
+    void integrate_span(Level& lv, const DataPoint& p0, const DataPoint& p1, double sign, Lookup lookup) {
+        double total = difftime(p1.timestamp, p0.timestamp);
+        if (total <= 0.0 || total > TW_MAX_GAP) return;
+        time_t a = p0.timestamp;
+        while (a < p1.timestamp) {
+            RollupBucket* bucket = lookup(lv, a);
+            time_t b = std::min(bucket ? bucket->end : period_start(lv.level, a, 1), p1.timestamp);
+            double f0 = difftime(a, p0.timestamp) / total, f1 = difftime(b, p0.timestamp) / total;
+            for (int ch = 0; bucket && ch < 2; ++ch) {
+                float v0 = ch == 0 ? p0.temperature : p0.pressure;
+                float v1 = ch == 0 ? p1.temperature : p1.pressure;
+                float va = method == IntegralMethod::Step ? v0 : v0 + (v1 - v0) * static_cast<float>(f0);
+                float vb = method == IntegralMethod::Step ? v0 : v0 + (v1 - v0) * static_cast<float>(f1);
+                bucket->channels[ch].add_segment(sign * segment_integral(va, vb, difftime(b, a), method),
+                                                 sign * difftime(b, a));
+            }
+            a = b;
         }
-        return stats;
     }
 
-    void draw_footer() const {
-        if (history.get_size() == 0) return;
-        const auto& last = history[history.get_size() - 1];
-        auto stats = calculate_statistics();
-        char info[256];
-        float altitude = 44330.0f * (1.0f - std::pow(last.pressure / 1013.25f, 0.1903f));
-        snprintf(info, sizeof(info),
-                 "Last: T=%.1f C, P=%.1f hPa, A=%.1f m | 5min: T(min/max/avg)=%.1f/%.1f/%.1f C, P(min/max/avg)=%.1f/%.1f/%.1f hPa",
-                 last.temperature, last.pressure, altitude,
-                 stats.min_temp, stats.max_temp, stats.avg_temp,
-                 stats.min_press, stats.max_press, stats.avg_press);
-        set_foreground(text_color);
-        XDrawString(dpy, pixmap, gc, 20, HEIGHT - 20, info, strlen(info));
+public:
+    explicit RollupStore(IntegralMethod integral_method) : method(integral_method) {}
+
+    void add(const DataPoint& p) {
+        if (last && p.timestamp < last->timestamp) return;
+        for (auto& lv : levels) {
+            if (last) integrate_span(lv, *last, p, 1.0, [this](Level& l, time_t t) { return &bucket_for(l, t); });
+            auto& bucket = bucket_for(lv, p.timestamp);
+            bucket.channels[0].add_sample(p.temperature);
+            bucket.channels[1].add_sample(p.pressure);
+        }
+        last = p;
     }
 
-    void draw_errors() const {
-        if (error_messages.empty() && persistent_errors.empty()) return;
-        set_foreground(colors[0]);
-        int y = 40;
-        for (const auto& msg : persistent_errors) {
-            XDrawString(dpy, pixmap, gc, 10, y, msg.c_str(), msg.length());
-            y += 15;
+    void add_late(const DataPoint& p, const std::optional<DataPoint>& prev, const std::optional<DataPoint>& next) {
+        if (!next) {
+            add(p);
+            return;
         }
-        if (difftime(time(nullptr), last_error_time) <= ERROR_DISPLAY_TIME) {
-            for (const auto& msg : error_messages) {
-                XDrawString(dpy, pixmap, gc, 10, y, msg.c_str(), msg.length());
-                y += 15;
+        auto find = [this](Level& l, time_t t) { return find_bucket(l, t); };
+        for (auto& lv : levels) {
+            if (prev) {
+                integrate_span(lv, *prev, *next, -1.0, find);
+                integrate_span(lv, *prev, p, 1.0, find);
+            }
+            integrate_span(lv, p, *next, 1.0, find);
+            if (auto* bucket = find_bucket(lv, p.timestamp)) {
+                bucket->channels[0].add_sample(p.temperature);
+                bucket->channels[1].add_sample(p.pressure);
             }
         }
     }
 
-    void draw_help() const {
-        if (!show_help) return;
+    std::vector<RollupBucket> buckets(RollupLevel level) const {
+        const auto& lv = levels[static_cast<int>(level)];
+        std::vector<RollupBucket> result(lv.closed.begin(), lv.closed.end());
+        if (lv.open) result.push_back(*lv.open);
+        return result;
+    }
 
-        const int line_height = 15;
-        const int padding = 10;
+    // Visits the buckets overlapping [from, to). Returns false when buckets at `from` were already
+    // dropped by retention, so the range is only partly covered.
+    template <typename Visit>
+    bool for_range(RollupLevel level, time_t from, time_t to, Visit visit) const {
+        const auto& lv = levels[static_cast<int>(level)];
+        auto it = std::upper_bound(lv.closed.begin(), lv.closed.end(), from,
+                                   [](time_t t, const RollupBucket& b) { return t < b.end; });
+        for (; it != lv.closed.end() && it->start < to; ++it) visit(*it);
+        if (lv.open && lv.open->start < to && lv.open->end > from) visit(*lv.open);
+        return lv.closed.size() < lv.retention || lv.closed.front().start <= from;
+    }
 
-        int max_width = 0;
-        for (const auto& line : help_lines) {
-            int width = XTextWidth(regular_font, line.data(), line.length());
-            if (width > max_width) max_width = width;
+    std::vector<RollupBucket> take_closed(RollupLevel level) {
+        auto& lv = levels[static_cast<int>(level)];
+        std::vector<RollupBucket> result(lv.closed.begin(), lv.closed.end());
+        lv.closed.clear();
+        return result;
+    }
+
+    void clear() {
+        for (auto& lv : levels) {
+            lv.closed.clear();
+            lv.open.reset();
+        }
+        last.reset();
+    }
+    void set_method(IntegralMethod m) { method = m; }
+
+    time_t last_timestamp() const { return last ? last->timestamp : 0; }
+
+    bool trim() {
+        auto& lv = levels[static_cast<int>(RollupLevel::Hour)];
+        if (lv.closed.size() < 2) return false;
+        lv.closed.erase(lv.closed.begin(), lv.closed.begin() + lv.closed.size() / 2);
+        lv.closed.shrink_to_fit();
+        lv.retention = std::max<size_t>(lv.closed.size(), 1);
+        return true;
+    }
+
+    size_t memory_usage() const {
+        size_t bytes = 0;
+        for (const auto& lv : levels) bytes += (lv.closed.size() + (lv.open ? 1 : 0)) * sizeof(RollupBucket);
+        return bytes;
+    }
+
+    void save(BinaryWriter& out) const {
+        auto save_bucket = [&out](const RollupBucket& b) {
+            out.put(b.start);
+            out.put(b.end);
+            for (const auto& agg : b.channels) agg.save(out);
+        };
+        for (const auto& lv : levels) {
+            out.put<uint64_t>(lv.closed.size());
+            for (const auto& b : lv.closed) save_bucket(b);
+            out.put<uint8_t>(lv.open.has_value());
+            if (lv.open) save_bucket(*lv.open);
+        }
+        save_point(out, last);
+    }
+    bool restore(BinaryReader& in) {
+        clear();
+        auto restore_bucket = [&in]() {
+            RollupBucket b{};
+            b.start = in.get<time_t>();
+            b.end = in.get<time_t>();
+            for (auto& agg : b.channels) agg.restore(in);
+            return b;
+        };
+        for (auto& lv : levels) {
+            uint64_t n = in.get<uint64_t>();
+            for (uint64_t i = 0; i < n && in.good(); ++i) lv.closed.push_back(restore_bucket());
+            while (lv.closed.size() > lv.retention) lv.closed.pop_front();
+            if (in.get<uint8_t>()) lv.open = restore_bucket();
+        }
+        last = restore_point(in);
+        if (!in.good()) clear();
+        return in.good();
+    }
+
+    static std::optional<RollupLevel> parse_level(const std::string& name) {
+        if (name == "hour") return RollupLevel::Hour;
+        if (name == "day") return RollupLevel::Day;
+        if (name == "month") return RollupLevel::Month;
+        return std::nullopt;
+    }
+};
+
+struct AccumulatorDef {
+    std::string name;
+    int channel;
+    bool above;
+    float threshold;
+    bool degree_days;
+};
+
+class AccumulatorStore {
+    struct Level {
+        RollupLevel level;
+        size_t limit;
+        std::map<time_t, std::vector<double>> buckets;
+        size_t retention = limit;
+        time_t current_start = 0, current_end = 0;
+    };
+
+    std::vector<AccumulatorDef> defs;
+    std::array<Level, 3> levels = {{{RollupLevel::Hour, 24 * 92, {}},
+                                    {RollupLevel::Day, 366 * 3, {}},
+                                    {RollupLevel::Month, 12 * 20, {}}}};
+    std::optional<DataPoint> last;
+    IntegralMethod method;
+
+    static void integrate(const AccumulatorDef& def, float va, float vb, double seconds, IntegralMethod method,
+                          double& exceed_seconds, double& area) {
+        double d0 = def.above ? va - def.threshold : def.threshold - va;
+        double d1 = def.above ? vb - def.threshold : def.threshold - vb;
+        exceed_seconds = area = 0.0;
+        if (method == IntegralMethod::Step || d0 == d1) {
+            if (d0 > 0.0) {
+                exceed_seconds = seconds;
+                area = d0 * seconds;
+            }
+        } else if (d0 >= 0.0 && d1 >= 0.0) {
+            exceed_seconds = seconds;
+            area = 0.5 * (d0 + d1) * seconds;
+        } else if (d0 > 0.0 || d1 > 0.0) {
+            double f = d0 / (d0 - d1);
+            exceed_seconds = d0 > 0.0 ? f * seconds : (1.0 - f) * seconds;
+            area = 0.5 * std::max(d0, d1) * exceed_seconds;
+        }
+    }
+
+    std::vector<double>& bucket_for(Level& lv, time_t t) {
+        if (t < lv.current_start || t >= lv.current_end) {
+            lv.current_start = period_start(lv.level, t, 0);
+            lv.current_end = period_start(lv.level, t, 1);
+        }
+        auto& bucket = lv.buckets[lv.current_start];
+        bucket.resize(defs.size(), 0.0);
+        while (lv.buckets.size() > lv.retention && lv.buckets.begin()->first != lv.current_start)
+            lv.buckets.erase(lv.buckets.begin());
+        return bucket;
+    }
+
+public:
+    explicit AccumulatorStore(IntegralMethod integral_method) : method(integral_method) {}
+
+    void set_definitions(std::vector<AccumulatorDef> definitions) {
+        defs = std::move(definitions);
+        for (auto& lv : levels) lv.buckets.clear();
+        last.reset();
+    }
+    const std::vector<AccumulatorDef>& definitions() const { return defs; }
+    void set_method(IntegralMethod m) { method = m; }
+
+    void integrate_span(Level& lv, const DataPoint& p0, const DataPoint& p1, double sign, bool create) {
+        double total = difftime(p1.timestamp, p0.timestamp);
+        if (defs.empty() || total <= 0.0 || total > TW_MAX_GAP) return;
+        time_t a = p0.timestamp;
+        while (a < p1.timestamp) {
+            std::vector<double>* bucket;
+            time_t end;
+            if (create) {
+                bucket = &bucket_for(lv, a);
+                end = lv.current_end;
+            } else {
+                bucket = &lv.buckets[period_start(lv.level, a, 0)];
+                bucket->resize(defs.size(), 0.0);
+                end = period_start(lv.level, a, 1);
+            }
+            time_t b = std::min(end, p1.timestamp);
+            double f0 = difftime(a, p0.timestamp) / total, f1 = difftime(b, p0.timestamp) / total;
+            for (size_t k = 0; k < defs.size(); ++k) {
+                float v0 = defs[k].channel == 0 ? p0.temperature : p0.pressure;
+                float v1 = defs[k].channel == 0 ? p1.temperature : p1.pressure;
+                float va = method == IntegralMethod::Step ? v0 : v0 + (v1 - v0) * static_cast<float>(f0);
+                float vb = method == IntegralMethod::Step ? v0 : v0 + (v1 - v0) * static_cast<float>(f1);
+                double exceed_seconds, area;
+                integrate(defs[k], va, vb, difftime(b, a), method, exceed_seconds, area);
+                (*bucket)[k] += sign * (defs[k].degree_days ? area / 86400.0 : exceed_seconds / 60.0);
+            }
+            a = b;
+        }
+    }
+
+    void add(const DataPoint& p) {
+        if (last && p.timestamp < last->timestamp) return;
+        if (last)
+            for (auto& lv : levels) integrate_span(lv, *last, p, 1.0, true);
+        last = p;
+    }
+
+    void add_late(const DataPoint& p, const std::optional<DataPoint>& prev, const std::optional<DataPoint>& next) {
+        if (!next) {
+            add(p);
+            return;
+        }
+        for (auto& lv : levels) {
+            if (prev) {
+                integrate_span(lv, *prev, *next, -1.0, false);
+                integrate_span(lv, *prev, p, 1.0, false);
+            }
+            integrate_span(lv, p, *next, 1.0, false);
+        }
+    }
+
+    std::vector<double> totals(RollupLevel level, time_t t) const {
+        const auto& buckets = levels[static_cast<int>(level)].buckets;
+        auto it = buckets.find(period_start(level, t, 0));
+        return it != buckets.end() ? it->second : std::vector<double>(defs.size(), 0.0);
+    }
+
+    const std::map<time_t, std::vector<double>>& buckets(RollupLevel level) const {
+        return levels[static_cast<int>(level)].buckets;
+    }
+
+    // Only hourly buckets are evicted; save() keeps their rows in the CSV.
+    bool trim() {
+        auto& lv = levels[static_cast<int>(RollupLevel::Hour)];
+        if (lv.buckets.size() < 2) return false;
+        auto end = std::next(lv.buckets.begin(), lv.buckets.size() / 2);
+        if (end->first > lv.current_start) end = lv.buckets.find(lv.current_start);
+        if (end == lv.buckets.begin() || end == lv.buckets.end()) return false;
+        lv.buckets.erase(lv.buckets.begin(), end);
+        lv.retention = std::max<size_t>(lv.buckets.size(), 1);
+        return true;
+    }
+
+    size_t memory_usage() const {
+        size_t bytes = 0;
+        for (const auto& lv : levels)
+            bytes += lv.buckets.size() * (sizeof(std::pair<const time_t, std::vector<double>>) + 4 * sizeof(void*) + defs.size() * sizeof(double));
+        return bytes;
+    }
+
+    time_t last_timestamp() const { return last ? last->timestamp : 0; }
+
+    void save(BinaryWriter& out) const {
+        out.put<uint32_t>(static_cast<uint32_t>(defs.size()));
+        for (const auto& def : defs) out.put_string(def.name);
+        for (const auto& lv : levels) {
+            out.put<uint64_t>(lv.buckets.size());
+            for (const auto& [start, values] : lv.buckets) {
+                out.put(start);
+                for (size_t k = 0; k < defs.size(); ++k) out.put(k < values.size() ? values[k] : 0.0);
+            }
+        }
+        save_point(out, last);
+    }
+    bool restore(BinaryReader& in) {
+        std::vector<int> slot;
+        uint32_t count = in.get<uint32_t>();
+        for (uint32_t k = 0; k < count && in.good(); ++k) {
+            std::string name = in.get_string();
+            auto def = std::find_if(defs.begin(), defs.end(), [&](const AccumulatorDef& d) { return d.name == name; });
+            slot.push_back(def != defs.end() ? static_cast<int>(def - defs.begin()) : -1);
+        }
+        std::array<std::map<time_t, std::vector<double>>, 3> restored;
+        for (size_t l = 0; l < levels.size() && in.good(); ++l) {
+            uint64_t n = in.get<uint64_t>();
+            for (uint64_t i = 0; i < n && in.good(); ++i) {
+                auto& bucket = restored[l][in.get<time_t>()];
+                bucket.resize(defs.size(), 0.0);
+                for (uint32_t k = 0; k < count && in.good(); ++k) {
+                    double value = in.get<double>();
+                    if (slot[k] >= 0) bucket[slot[k]] = value;
+                }
+            }
+        }
+        auto restored_last = restore_point(in);
+        if (!in.good()) return false;
+        for (size_t l = 0; l < levels.size(); ++l) {
+            levels[l].buckets = std::move(restored[l]);
+            levels[l].current_start = levels[l].current_end = 0;
+        }
+        last = restored_last;
+        return true;
+    }
+
+    // Rows older than the buckets still in memory (evicted by trim() or missing from a restored
+    // checkpoint) are carried over from the existing file as long as they fall within the level's limit.
+    bool save(const std::string& path) const {
+        std::string temp_path = path + ".tmp";
+        std::ofstream out(temp_path);
+        if (!out) return false;
+        out << "level,start,name,value\n" << std::setprecision(10);
+        std::ifstream previous(path);
+        std::string line;
+        while (previous && std::getline(previous, line)) {
+            std::istringstream iss(line);
+            std::string level_name, start_str;
+            if (!std::getline(iss, level_name, ',') || !std::getline(iss, start_str, ',')) continue;
+            auto level = RollupStore::parse_level(level_name);
+            if (!level) continue;
+            const auto& lv = levels[static_cast<int>(*level)];
+            try {
+                time_t start = std::stoll(start_str);
+                if (!lv.buckets.empty() &&
+                    (start >= lv.buckets.begin()->first ||
+                     start < period_start(lv.level, lv.buckets.rbegin()->first, 1 - static_cast<int>(lv.limit))))
+                    continue;
+            } catch (const std::exception&) {
+                continue;
+            }
+            out << line << "\n";
+        }
+        for (const auto& lv : levels) {
+            for (const auto& [start, values] : lv.buckets) {
+                for (size_t k = 0; k < defs.size() && k < values.size(); ++k)
+                    out << rollup_level_name(lv.level) << "," << start << "," << defs[k].name << "," << values[k] << "\n";
+            }
+        }
+        out.close();
+        if (out.fail()) return false;
+        std::error_code ec;
+        std::filesystem::rename(temp_path, path, ec);
+        return !ec;
+    }
+
+    bool load(const std::string& path) {
+        std::ifstream in(path);
+        if (!in) return false;
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream iss(line);
+            std::string level_name, start_str, name, value_str;
+            if (!std::getline(iss, level_name, ',') || !std::getline(iss, start_str, ',') ||
+                !std::getline(iss, name, ',') || !std::getline(iss, value_str)) continue;
+            auto level = RollupStore::parse_level(level_name);
+            auto def = std::find_if(defs.begin(), defs.end(), [&](const AccumulatorDef& d) { return d.name == name; });
+            if (!level || def == defs.end()) continue;
+            try {
+                auto& bucket = levels[static_cast<int>(*level)].buckets[std::stoll(start_str)];
+                bucket.resize(defs.size(), 0.0);
+                bucket[def - defs.begin()] = std::stod(value_str);
+            } catch (const std::exception&) {
+                continue;
+            }
+        }
+        return true;
+    }
+
+    static std::optional<AccumulatorDef> parse_definition(const std::string& spec) {
+        size_t op = spec.find_first_of("<>");
+        if (op == std::string::npos) return std::nullopt;
+        std::string channel = spec.substr(0, op);
+        if (channel != "temp" && channel != "press") return std::nullopt;
+        try {
+            float threshold = std::stof(spec.substr(op + 1));
+            bool above = spec[op] == '>';
+            std::ostringstream name;
+            name << channel << (above ? "_above_" : "_below_") << spec.substr(op + 1) << "_min";
+            return AccumulatorDef{name.str(), channel == "temp" ? 0 : 1, above, threshold, false};
+        } catch (const std::exception&) {
+            return std::nullopt;
+        }
+    }
+};
+
+// Folds a late sample into the rollups and accumulators. The neighbours come from the range index,
+// which holds every raw sample even while the history only keeps decimated means.
+bool patch_late(RangeIndex& index, RollupStore& rollups, AccumulatorStore& accumulators, const DataPoint& p) {
+    std::optional<DataPoint> prev, next;
+    if (!index.neighbours(p.timestamp, prev, next)) return false;
+    rollups.add_late(p, prev, next);
+    accumulators.add_late(p, prev, next);
+    index.insert(p);
+    return true;
+}
+
+class ReorderBuffer {
+    struct Later {
+        bool operator()(const DataPoint& a, const DataPoint& b) const { return a.timestamp > b.timestamp; }
+    };
+
+    std::priority_queue<DataPoint, std::vector<DataPoint>, Later> held;
+    time_t lateness;
+    size_t capacity;
+    time_t newest = 0, drained_newest = 0, idle_since = 0;
+    std::optional<time_t> emitted;
+
+public:
+    ReorderBuffer(time_t lateness_seconds, size_t max_held = REORDER_MAX_HELD)
+        : lateness(lateness_seconds), capacity(max_held) {}
+
+    void set_lateness(time_t seconds) { lateness = seconds; }
+
+    // Returns false when samples newer than this one were already released; the caller has to patch it in.
+    bool push(const DataPoint& p) {
+        if (emitted && p.timestamp < *emitted) return false;
+        held.push(p);
+        newest = std::max(newest, p.timestamp);
+        return true;
+    }
+
+    // The horizon follows the newest event timestamp, so replayed or merged history is reordered too.
+    // The wall clock only flushes everything once no newer sample has arrived for the lateness window.
+    template <typename Emit>
+    void drain(time_t now, Emit emit) {
+        if (newest != drained_newest) {
+            drained_newest = newest;
+            idle_since = now;
+        }
+        time_t horizon = difftime(now, idle_since) >= lateness ? newest : newest - lateness;
+        while (!held.empty() && (held.top().timestamp <= horizon || held.size() > capacity)) {
+            DataPoint p = held.top();
+            held.pop();
+            emitted = p.timestamp;
+            emit(p);
+        }
+    }
+
+    template <typename Emit>
+    void flush(Emit emit) {
+        drain(std::numeric_limits<time_t>::max() / 2, emit);
+    }
+
+    time_t newest_timestamp() const { return newest; }
+    size_t get_held() const { return held.size(); }
+    size_t memory_usage() const { return held.size() * sizeof(DataPoint); }
+};
+
+class MemoryAccountant {
+    struct Consumer {
+        std::string name;
+        int cost;
+        std::function<size_t()> usage;
+        std::function<bool()> shrink;
+        size_t bytes = 0;
+        uint64_t evictions = 0;
+    };
+
+    std::vector<Consumer> consumers;
+    size_t budget;
+
+public:
+    explicit MemoryAccountant(size_t budget_bytes) : budget(budget_bytes) {}
+
+    void set_budget(size_t bytes) { budget = bytes; }
+    size_t get_budget() const { return budget; }
+
+    // Consumers with a shrink function are downgraded cheapest cost first until the total fits the budget.
+    void track(const std::string& name, std::function<size_t()> usage, std::function<bool()> shrink = nullptr, int cost = 0) {
+        consumers.push_back({name, cost, std::move(usage), std::move(shrink)});
+        std::stable_sort(consumers.begin(), consumers.end(), [](const Consumer& a, const Consumer& b) { return a.cost < b.cost; });
+    }
+
+    size_t refresh() {
+        size_t total = 0;
+        for (auto& c : consumers) total += c.bytes = c.usage();
+        return total;
+    }
+
+    size_t enforce() {
+        size_t total = refresh();
+        for (auto& c : consumers) {
+            while (total > budget && c.shrink && c.shrink()) {
+                ++c.evictions;
+                total -= c.bytes;
+                total += c.bytes = c.usage();
+            }
+        }
+        return total;
+    }
+
+    size_t total() const {
+        size_t sum = 0;
+        for (const auto& c : consumers) sum += c.bytes;
+        return sum;
+    }
+
+    template <typename Visit>
+    void for_each(Visit visit) const {
+        for (const auto& c : consumers) visit(c.name, c.bytes, c.evictions);
+    }
+};
+
+// Decides how much of the main loop may go to rendering. Ingest and persistence are never shed: under
+// overload the frame rate drops first, then the detail drawn per frame, and background analytics wait.
+class LoadShedder {
+    static constexpr const char* names[] = {"normal", "elevated", "high", "critical"};
+    static constexpr uint64_t frame_interval_us[] = {0, 200000, 1000000, 5000000};
+
+    double work_us = 0.0;
+    double frame_us = 0.0;
+    int level = 0;
+    uint64_t last_frame = 0;
+    uint64_t calm_since = 0;
+    uint64_t level_since = 0;
+    uint64_t transitions = 0;
+    double seconds[4] = {};
+
+    static int level_for(double cost_us) {
+        return cost_us >= 5.0 * OVERLOAD_BUDGET_US ? 3 : cost_us >= 2.5 * OVERLOAD_BUDGET_US ? 2 : cost_us >= OVERLOAD_BUDGET_US ? 1 : 0;
+    }
+
+public:
+    // work: time the last loop iteration spent working, excluding waits for serial input and the
+    // frames themselves (reported through frame_done); queued: bytes waiting in the tty.
+    // Levels rise immediately and fall one step at a time after OVERLOAD_CALM_US below target.
+    bool update(uint64_t work, int queued, uint64_t now) {
+        work_us = 0.8 * work_us + 0.2 * work;
+        int target = std::max({level_for(work_us), level_for(frame_us), std::min(3, queued / 1024)});
+        if (level_since != 0) seconds[level] += (now - level_since) / 1e6;
+        level_since = now;
+        int previous = level;
+        if (target > level) {
+            level = target;
+            calm_since = 0;
+        } else if (target == level) {
+            calm_since = 0;
+        } else if (calm_since == 0) {
+            calm_since = now;
+        } else if (now - calm_since >= OVERLOAD_CALM_US) {
+            --level;
+            calm_since = now;
+        }
+        if (level != previous) ++transitions;
+        return level != previous;
+    }
+
+    void frame_started(uint64_t now) { last_frame = now; }
+    void frame_done(uint64_t cost) { frame_us = frame_us == 0.0 ? cost : 0.5 * frame_us + 0.5 * cost; }
+
+    bool frame_due(uint64_t now) const { return now - last_frame >= frame_interval_us[level]; }
+    uint64_t until_frame(uint64_t now) const {
+        return frame_due(now) ? 0 : frame_interval_us[level] - (now - last_frame);
+    }
+    int point_stride() const { return level >= 3 ? 4 : level >= 2 ? 2 : 1; }
+    bool draw_overlays() const { return level < 2; }
+    bool analytics_allowed() const { return level < 2; }
+    bool fetch_allowed() const { return level < 1; }
+
+    int get_level() const { return level; }
+    const char* name() const { return names[level]; }
+    static const char* name(int l) { return names[l]; }
+    uint64_t get_transitions() const { return transitions; }
+    double get_work_us() const { return work_us; }
+    double get_frame_us() const { return frame_us; }
+    double seconds_at(int l) const { return seconds[l]; }
+};
+
+// Derived GUI state as a dependency graph. Inputs poll the state they stand for and take a new version
+// when it changes. A derived node recomputes only when one of its dependencies has a newer version
+// than its last run, and keeps its own version when the result came out the same, so unchanged
+// results stop the propagation. Nodes must be added after their dependencies.
+class DependencyGraph {
+    struct Node {
+        std::string name;
+        std::vector<int> deps;
+        std::vector<int> inputs;
+        std::vector<int> chain;
+        std::function<uint64_t()> probe;
+        std::function<bool()> compute;
+        uint64_t value = 0;
+        uint64_t version = 0;
+        uint64_t checked = 0;
+        uint64_t recomputes = 0;
+        bool recomputed = false;
+    };
+
+    std::vector<Node> nodes;
+    uint64_t clock = 0;
+
+public:
+    int input(const std::string& name, std::function<uint64_t()> probe) {
+        int id = static_cast<int>(nodes.size());
+        Node n;
+        n.name = name;
+        n.probe = std::move(probe);
+        n.value = n.probe();
+        n.version = ++clock;
+        n.inputs = {id};
+        nodes.push_back(std::move(n));
+        return id;
+    }
+
+    int derived(const std::string& name, const std::vector<int>& deps, std::function<bool()> compute) {
+        int id = static_cast<int>(nodes.size());
+        Node n;
+        n.name = name;
+        n.deps = deps;
+        n.compute = std::move(compute);
+        n.version = ++clock;
+        std::vector<bool> in_chain(nodes.size(), false), is_input(nodes.size(), false);
+        for (int d : deps) {
+            for (int c : nodes[d].chain) in_chain[c] = true;
+            for (int i : nodes[d].inputs) is_input[i] = true;
+        }
+        for (int i = 0; i < id; ++i) {
+            if (in_chain[i]) n.chain.push_back(i);
+            if (is_input[i]) n.inputs.push_back(i);
+        }
+        n.chain.push_back(id);
+        nodes.push_back(std::move(n));
+        return id;
+    }
+
+    void sync() {
+        for (auto& n : nodes) {
+            if (!n.probe) continue;
+            uint64_t value = n.probe();
+            if (value != n.value) {
+                n.value = value;
+                n.version = ++clock;
+            }
+        }
+    }
+
+    bool stale(int id) const {
+        for (int i : nodes[id].inputs)
+            if (nodes[i].version > nodes[id].checked) return true;
+        return false;
+    }
+
+    void evaluate(int id) {
+        for (int c : nodes[id].chain) {
+            Node& n = nodes[c];
+            uint64_t newest = 0;
+            for (int d : n.deps) newest = std::max(newest, nodes[d].version);
+            uint64_t seen = n.checked;
+            n.checked = clock;
+            if (newest <= seen) continue;
+            ++n.recomputes;
+            n.recomputed = true;
+            if (n.compute()) n.version = ++clock;
+        }
+    }
+
+    uint64_t version(int id) const { return nodes[id].version; }
+
+    // Reports every derived node with whether it ran since the previous call and its total runs.
+    template <typename Visit>
+    void take_recomputed(Visit visit) {
+        for (auto& n : nodes) {
+            if (!n.compute) continue;
+            visit(n.name, n.recomputed, n.recomputes);
+            n.recomputed = false;
+        }
+    }
+};
+
+class Metrics {
+    std::map<std::string, double> values;
+    mutable std::mutex mutex;
+
+public:
+    void set(const std::string& series, double value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        values[series] = value;
+    }
+    void add(const std::string& series, double delta) {
+        std::lock_guard<std::mutex> lock(mutex);
+        values[series] += delta;
+    }
+    double get(const std::string& series) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = values.find(series);
+        return it != values.end() ? it->second : 0.0;
+    }
+    std::map<std::string, double> all() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return values;
+    }
+
+    bool write(const std::string& path) const {
+        std::ostringstream out;
+        out << std::setprecision(12);
+        for (const auto& [series, value] : all()) out << series << " " << value << "\n";
+        return write_file_atomic(path, out.str());
+    }
+};
+
+struct SampleBatch {
+    uint64_t first_seq;
+    std::vector<DataPoint> points;
+};
+
+// Lossy readers that fall more than the capacity behind skip ahead. Lossless readers (the persistence
+// sinks) pin their unread batches instead: the ring grows past its capacity until they catch up.
+class BroadcastRing {
+    std::deque<std::shared_ptr<const SampleBatch>> slots;
+    std::vector<uint64_t> pins;
+    size_t capacity;
+    uint64_t base = 0;
+    uint64_t head = 0;
+    uint64_t next_sample_seq = 0;
+    bool closed = false;
+    mutable std::mutex mutex;
+    std::condition_variable cv;
+
+    void release_locked() {
+        uint64_t pinned = pins.empty() ? head : *std::min_element(pins.begin(), pins.end());
+        while (slots.size() > capacity && base < pinned) {
+            slots.pop_front();
+            ++base;
+        }
+    }
+
+public:
+    struct Subscription {
+        uint64_t cursor;
+        uint64_t sample_seq;
+        int pin;
+    };
+
+    explicit BroadcastRing(size_t max_batches = SINK_RING_CAPACITY) : capacity(max_batches) {}
+
+    void publish(std::vector<DataPoint> points) {
+        if (points.empty()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto batch = std::make_shared<const SampleBatch>(SampleBatch{next_sample_seq, std::move(points)});
+            next_sample_seq += batch->points.size();
+            slots.push_back(std::move(batch));
+            ++head;
+            release_locked();
+        }
+        cv.notify_all();
+    }
+
+    Subscription subscribe(bool lossless) {
+        std::lock_guard<std::mutex> lock(mutex);
+        int pin = -1;
+        if (lossless) {
+            pin = static_cast<int>(pins.size());
+            pins.push_back(head);
+        }
+        return {head, next_sample_seq, pin};
+    }
+
+    std::shared_ptr<const SampleBatch> wait(uint64_t& cursor, int pin = -1) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (pin >= 0) {
+            pins[pin] = cursor;
+            release_locked();
+        }
+        cv.wait(lock, [&] { return cursor < head || closed; });
+        if (cursor >= head) return nullptr;
+        if (cursor < base) cursor = base;
+        if (pin < 0 && head - cursor > capacity) cursor = head - capacity;
+        return slots[cursor++ - base];
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closed = true;
+        }
+        cv.notify_all();
+    }
+
+    uint64_t get_head() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return head;
+    }
+    uint64_t get_next_sample_seq() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return next_sample_seq;
+    }
+
+    size_t memory_usage() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t bytes = slots.size() * sizeof(slots[0]) + pins.capacity() * sizeof(uint64_t);
+        for (const auto& batch : slots)
+            if (batch) bytes += sizeof(SampleBatch) + batch->points.capacity() * sizeof(DataPoint);
+        return bytes;
+    }
+};
+
+// Bounded multi-producer, single-consumer queue. Producers claim a contiguous run of slots with one
+// CAS on the tail and publish each slot through its sequence number; the consumer drains as many
+// published slots as are ready and hands them back with a single store to the head. The two indices
+// live on separate cache lines so producers and the consumer do not invalidate each other's line.
+template <typename T>
+class MpscQueue {
+    struct Cell {
+        std::atomic<uint64_t> seq{0};
+        T value{};
+    };
+
+    alignas(CACHE_LINE) std::atomic<uint64_t> tail{0};
+    alignas(CACHE_LINE) std::atomic<uint64_t> head{0};
+    alignas(CACHE_LINE) std::unique_ptr<Cell[]> cells;
+    size_t capacity;
+    size_t mask;
+
+public:
+    explicit MpscQueue(size_t min_capacity) {
+        capacity = 1;
+        while (capacity < min_capacity) capacity <<= 1;
+        mask = capacity - 1;
+        cells = std::make_unique<Cell[]>(capacity);
+    }
+
+    // Moves all n items in or none of them; fails when fewer than n slots are free.
+    bool try_push(T* items, size_t n) {
+        if (n > capacity) return false;
+        uint64_t pos = tail.load(std::memory_order_relaxed);
+        do {
+            if (pos + n - head.load(std::memory_order_acquire) > capacity) return false;
+        } while (!tail.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed, std::memory_order_relaxed));
+        for (size_t i = 0; i < n; ++i) {
+            Cell& c = cells[(pos + i) & mask];
+            c.value = std::move(items[i]);
+            c.seq.store(pos + i + 1, std::memory_order_release);
+        }
+        return true;
+    }
+
+    bool try_push(T item) { return try_push(&item, 1); }
+
+    void push(T* items, size_t n) {
+        while (!try_push(items, n)) std::this_thread::yield();
+    }
+
+    // Consumer only. Calls consume(T&&) for up to max published items in order and returns the count.
+    template <typename Consume>
+    size_t pop(Consume consume, size_t max = SIZE_MAX) {
+        uint64_t pos = head.load(std::memory_order_relaxed);
+        size_t n = 0;
+        for (; n < max; ++n) {
+            Cell& c = cells[(pos + n) & mask];
+            if (c.seq.load(std::memory_order_acquire) != pos + n + 1) break;
+            consume(std::move(c.value));
+        }
+        if (n > 0) head.store(pos + n, std::memory_order_release);
+        return n;
+    }
+
+    size_t size() const {
+        return static_cast<size_t>(tail.load(std::memory_order_relaxed) - head.load(std::memory_order_relaxed));
+    }
+    size_t get_capacity() const { return capacity; }
+};
+
+class OutputSink {
+public:
+    virtual ~OutputSink() = default;
+    virtual bool write(const SampleBatch& batch) = 0;
+    // Lossless sinks never have batches overwritten in the broadcast ring, however far behind they fall.
+    virtual bool lossless() const { return false; }
+};
+
+class CsvSink : public OutputSink {
+    std::ofstream out;
+    char delimiter;
+    std::mutex mutex;
+    std::optional<std::pair<std::string, uint64_t>> retarget_to;
+
+public:
+    CsvSink(const std::string& path, char delim) : out(path, std::ios::app), delimiter(delim) {
+        if (!out) throw std::runtime_error("Failed to open CSV sink: " + path);
+    }
+    bool lossless() const override { return true; }
+
+    // Batches from sample sequence first_seq on are appended to path instead. Called from another thread.
+    void retarget(const std::string& path, uint64_t first_seq) {
+        std::lock_guard<std::mutex> lock(mutex);
+        retarget_to.emplace(path, first_seq);
+    }
+
+    bool write(const SampleBatch& batch) override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (retarget_to && batch.first_seq >= retarget_to->second) {
+                out.close();
+                out.open(retarget_to->first, std::ios::app);
+                retarget_to.reset();
+            }
+        }
+        for (const auto& d : batch.points)
+            out << d.temperature << delimiter << d.pressure << delimiter << d.timestamp << "\n";
+        out.flush();
+        return static_cast<bool>(out);
+    }
+};
+
+#pragma pack(push, 1)
+struct ArchiveRecord {
+    int64_t timestamp;
+    float temperature;
+    float pressure;
+};
+#pragma pack(pop)
+
+// Samples older than the archive's newest record go to this side file (bare records, no magic) so
+// that the archive itself stays sorted for ArchiveReader's binary search.
+std::string archive_late_path(const std::string& path) { return path + ".late"; }
+
+class ArchiveSink : public OutputSink {
+    std::ofstream out, late;
+    std::string late_path;
+    time_t newest = std::numeric_limits<time_t>::min();
+
+public:
+    explicit ArchiveSink(const std::string& path) : late_path(archive_late_path(path)) {
+        std::error_code ec;
+        auto size = std::filesystem::file_size(path, ec);
+        bool fresh = ec || size == 0;
+        if (!fresh && size >= 8 + sizeof(ArchiveRecord)) {
+            std::ifstream in(path, std::ios::binary);
+            ArchiveRecord r{};
+            in.seekg(8 + (size - 8) / sizeof(ArchiveRecord) * sizeof(ArchiveRecord) - sizeof(r));
+            if (in.read(reinterpret_cast<char*>(&r), sizeof(r))) newest = static_cast<time_t>(r.timestamp);
+        }
+        out.open(path, std::ios::binary | std::ios::app);
+        if (!out) throw std::runtime_error("Failed to open archive sink: " + path);
+        if (fresh) out.write(ARCHIVE_MAGIC, 8);
+    }
+    bool lossless() const override { return true; }
+    bool write(const SampleBatch& batch) override {
+        bool wrote_late = false;
+        for (const auto& d : batch.points) {
+            ArchiveRecord r{static_cast<int64_t>(d.timestamp), d.temperature, d.pressure};
+            if (d.timestamp >= newest) {
+                out.write(reinterpret_cast<const char*>(&r), sizeof(r));
+                newest = d.timestamp;
+                continue;
+            }
+            if (!late.is_open()) late.open(late_path, std::ios::binary | std::ios::app);
+            late.write(reinterpret_cast<const char*>(&r), sizeof(r));
+            wrote_late = true;
+        }
+        out.flush();
+        if (wrote_late) late.flush();
+        return out && (!wrote_late || late);
+    }
+};
+
+// Slot index of the calling thread in every EpochDomain; released for reuse when the thread exits.
+int epoch_thread_index() {
+    static std::mutex mutex;
+    static std::vector<int> free_slots;
+    static int next = 0;
+    struct Index {
+        int value = -1;
+        ~Index() {
+            if (value < 0) return;
+            std::lock_guard<std::mutex> lock(mutex);
+            free_slots.push_back(value);
+        }
+    };
+    thread_local Index index;
+    if (index.value < 0) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!free_slots.empty()) {
+            index.value = free_slots.back();
+            free_slots.pop_back();
+        } else if (next < EPOCH_MAX_THREADS) {
+            index.value = next++;
+        } else {
+            throw std::runtime_error("Too many threads for epoch reclamation");
+        }
+    }
+    return index.value;
+}
+
+// Epoch-based reclamation. Readers announce the global epoch while they hold a Guard; an object
+// retired in epoch e is freed once the epoch has advanced twice, which can only happen after every
+// reader that might still see it has left. Readers never block and never write shared state.
+class EpochDomain {
+    struct alignas(CACHE_LINE) Slot {
+        std::atomic<uint64_t> epoch{0};
+    };
+    struct Retired {
+        uint64_t epoch;
+        std::function<void()> free;
+    };
+
+    std::atomic<uint64_t> global{1};
+    std::array<Slot, EPOCH_MAX_THREADS> slots;
+    std::mutex retire_mutex;
+    std::vector<Retired> retired;
+    std::atomic<uint64_t> freed{0};
+
+    bool try_advance() {
+        uint64_t epoch = global.load();
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for (const auto& slot : slots) {
+            uint64_t e = slot.epoch.load(std::memory_order_acquire);
+            if (e != 0 && e != epoch) return false;
+        }
+        return global.compare_exchange_strong(epoch, epoch + 1);
+    }
+
+public:
+    // Not reentrant: a thread holds at most one guard per domain.
+    class Guard {
+        std::atomic<uint64_t>& epoch;
+
+    public:
+        explicit Guard(EpochDomain& domain) : epoch(domain.slots[epoch_thread_index()].epoch) {
+            epoch.store(domain.global.load(), std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+        ~Guard() { epoch.store(0, std::memory_order_release); }
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+    };
+
+    ~EpochDomain() {
+        for (auto& r : retired) r.free();
+    }
+
+    // Called after the object has been unlinked, so no new reader can reach it.
+    void retire(std::function<void()> free) {
+        std::lock_guard<std::mutex> lock(retire_mutex);
+        retired.push_back({global.load(), std::move(free)});
+        collect_locked();
+    }
+
+    void collect() {
+        std::lock_guard<std::mutex> lock(retire_mutex);
+        collect_locked();
+    }
+
+    size_t get_pending() {
+        std::lock_guard<std::mutex> lock(retire_mutex);
+        return retired.size();
+    }
+    uint64_t get_freed() const { return freed; }
+    uint64_t get_epoch() const { return global; }
+
+private:
+    void collect_locked() {
+        try_advance();
+        uint64_t epoch = global.load();
+        auto done = std::partition(retired.begin(), retired.end(), [&](const Retired& r) { return r.epoch + 2 > epoch; });
+        for (auto it = done; it != retired.end(); ++it) it->free();
+        freed += retired.end() - done;
+        retired.erase(done, retired.end());
+    }
+};
+
+struct DecodedBlock {
+    uint64_t file;
+    uint64_t index;
+    std::vector<DataPoint> points;
+    mutable std::atomic<uint64_t> last_used{0};
+};
+
+// Shared cache of decoded archive blocks. Lookups are lock-free: a reader pins the epoch, scans the
+// four ways of the block's set and uses the block until its guard ends. Replaced or evicted blocks
+// are retired to the epoch domain and freed only when no reader can still hold them.
+class BlockCache {
+    static constexpr size_t ways = 4;
+    struct alignas(CACHE_LINE) Counters {
+        std::atomic<uint64_t> hits{0}, misses{0};
+    };
+
+    size_t sets;
+    std::unique_ptr<std::atomic<DecodedBlock*>[]> slots;
+    EpochDomain epochs;
+    std::array<Counters, EPOCH_MAX_THREADS> counters;
+    std::atomic<uint64_t> clock{0};
+    std::atomic<uint64_t> evictions{0};
+    std::atomic<size_t> bytes{0};
+    std::atomic<size_t> blocks{0};
+    std::atomic<size_t> sweep{0};
+
+    size_t set_of(uint64_t file, uint64_t index) const {
+        return static_cast<size_t>((file ^ (index * 0x9E3779B97F4A7C15ull)) >> 7) % sets;
+    }
+
+    static size_t block_bytes(const DecodedBlock& b) { return sizeof(DecodedBlock) + b.points.capacity() * sizeof(DataPoint); }
+
+    void retire(DecodedBlock* b) {
+        blocks.fetch_sub(1, std::memory_order_relaxed);
+        epochs.retire([this, b] {
+            // Poisoned before release so a reader that outlived its grace period would see it.
+            for (auto& p : b->points) p.timestamp = -1;
+            bytes.fetch_sub(block_bytes(*b), std::memory_order_relaxed);
+            delete b;
+        });
+    }
+
+public:
+    using Guard = EpochDomain::Guard;
+
+    explicit BlockCache(size_t capacity_blocks)
+        : sets(std::max<size_t>(1, capacity_blocks / ways)), slots(std::make_unique<std::atomic<DecodedBlock*>[]>(sets * ways)) {
+        for (size_t i = 0; i < sets * ways; ++i) slots[i].store(nullptr, std::memory_order_relaxed);
+    }
+    ~BlockCache() {
+        for (size_t i = 0; i < sets * ways; ++i) delete slots[i].load();
+    }
+    BlockCache(const BlockCache&) = delete;
+    BlockCache& operator=(const BlockCache&) = delete;
+
+    EpochDomain& domain() { return epochs; }
+
+    // The caller must hold a Guard on domain() for as long as it uses the returned block.
+    const DecodedBlock* find(uint64_t file, uint64_t index) {
+        auto& c = counters[epoch_thread_index()];
+        size_t base = set_of(file, index) * ways;
+        for (size_t w = 0; w < ways; ++w) {
+            const DecodedBlock* b = slots[base + w].load(std::memory_order_acquire);
+            if (b && b->file == file && b->index == index) {
+                uint64_t now = clock.load(std::memory_order_relaxed);
+                if (b->last_used.load(std::memory_order_relaxed) != now) b->last_used.store(now, std::memory_order_relaxed);
+                c.hits.fetch_add(1, std::memory_order_relaxed);
+                return b;
+            }
+        }
+        c.misses.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    // Caller holds a Guard. Replaces an empty or the least recently used way of the set; if another
+    // thread cached the same block first, that copy is returned instead.
+    const DecodedBlock* insert(uint64_t file, uint64_t index, std::vector<DataPoint> points) {
+        auto* block = new DecodedBlock{file, index, std::move(points)};
+        block->last_used = clock.fetch_add(1, std::memory_order_relaxed) + 1;
+        bytes.fetch_add(block_bytes(*block), std::memory_order_relaxed);
+        size_t base = set_of(file, index) * ways;
+        while (true) {
+            size_t victim = 0;
+            DecodedBlock* old = nullptr;
+            uint64_t oldest = UINT64_MAX;
+            for (size_t w = 0; w < ways; ++w) {
+                DecodedBlock* b = slots[base + w].load(std::memory_order_acquire);
+                if (b && b->file == file && b->index == index) {
+                    bytes.fetch_sub(block_bytes(*block), std::memory_order_relaxed);
+                    delete block;
+                    return b;
+                }
+                uint64_t used = b ? b->last_used.load(std::memory_order_relaxed) : 0;
+                if (used < oldest) {
+                    oldest = used;
+                    victim = w;
+                    old = b;
+                }
+            }
+            if (!slots[base + victim].compare_exchange_strong(old, block, std::memory_order_acq_rel)) continue;
+            blocks.fetch_add(1, std::memory_order_relaxed);
+            if (old) {
+                evictions.fetch_add(1, std::memory_order_relaxed);
+                retire(old);
+            }
+            return block;
+        }
+    }
+
+    // Evicts about an eighth of the slots, sweeping round the table; false when nothing was cached.
+    bool shrink() {
+        size_t total = sets * ways, step = std::max<size_t>(1, total / 8), evicted = 0;
+        size_t start = sweep.fetch_add(step, std::memory_order_relaxed);
+        for (size_t i = 0; i < step; ++i) {
+            if (DecodedBlock* b = slots[(start + i) % total].exchange(nullptr, std::memory_order_acq_rel)) {
+                evictions.fetch_add(1, std::memory_order_relaxed);
+                retire(b);
+                ++evicted;
+            }
+        }
+        epochs.collect();
+        return evicted > 0 || blocks.load() > 0;
+    }
+
+    uint64_t get_hits() const {
+        uint64_t sum = 0;
+        for (const auto& c : counters) sum += c.hits.load(std::memory_order_relaxed);
+        return sum;
+    }
+    uint64_t get_misses() const {
+        uint64_t sum = 0;
+        for (const auto& c : counters) sum += c.misses.load(std::memory_order_relaxed);
+        return sum;
+    }
+    uint64_t get_evictions() const { return evictions; }
+    size_t get_blocks() const { return blocks; }
+    size_t memory_usage() const { return bytes.load() + sets * ways * sizeof(DecodedBlock*); }
+};
+
+class ArchiveReader {
+public:
+    // Visits the archived samples with from <= timestamp <= to in order; with a limit, only every
+    // stride-th so that at most limit are visited. With a cache, complete blocks are decoded once and
+    // shared; the growing tail block is always read. Returns the timestamps of the archive's first
+    // and last records, or nullopt when it holds none.
+    template <typename Visit>
+    static std::optional<std::pair<time_t, time_t>> scan(const std::string& path, time_t from, time_t to, size_t limit,
+                                                         BlockCache* cache, Visit visit) {
+        std::ifstream in(path, std::ios::binary);
+        char magic[8];
+        if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, ARCHIVE_MAGIC, sizeof(magic)) != 0) return std::nullopt;
+        in.seekg(0, std::ios::end);
+        size_t n = (static_cast<size_t>(in.tellg()) - sizeof(magic)) / sizeof(ArchiveRecord);
+        if (n == 0) return std::nullopt;
+        auto at = [&](size_t i) {
+            ArchiveRecord r{};
+            in.seekg(sizeof(magic) + i * sizeof(ArchiveRecord));
+            in.read(reinterpret_cast<char*>(&r), sizeof(r));
+            return r;
+        };
+        auto bound = [&](time_t t, bool upper) {
+            size_t lo = 0, hi = n;
+            while (lo < hi) {
+                size_t mid = (lo + hi) / 2;
+                time_t ts = static_cast<time_t>(at(mid).timestamp);
+                if (upper ? ts <= t : ts < t) lo = mid + 1;
+                else hi = mid;
+            }
+            return lo;
+        };
+        std::pair<time_t, time_t> extent{static_cast<time_t>(at(0).timestamp), static_cast<time_t>(at(n - 1).timestamp)};
+        size_t first = bound(from, false), last = bound(to, true);
+        size_t stride = limit && first < last ? (last - first + limit - 1) / limit : 1;
+        // Strided reads are a preview, so only complete reads merge the late side file.
+        std::vector<DataPoint> late;
+        if (stride == 1) late = read_late(path, from, to);
+        size_t pending = 0;
+        auto emit = [&](const DataPoint& p) {
+            for (; pending < late.size() && late[pending].timestamp < p.timestamp; ++pending) visit(late[pending]);
+            visit(p);
+        };
+        if (first >= last) {
+            for (const auto& p : late) visit(p);
+            return extent;
+        }
+
+        uint64_t file = fnv1a(path.data(), path.size());
+        std::optional<BlockCache::Guard> guard;
+        if (cache) guard.emplace(cache->domain());
+        std::vector<ArchiveRecord> records(ARCHIVE_BLOCK_RECORDS);
+        std::vector<DataPoint> scratch;
+        auto block = [&](size_t b) -> const std::vector<DataPoint>& {
+            size_t begin = b * ARCHIVE_BLOCK_RECORDS, count = std::min<size_t>(ARCHIVE_BLOCK_RECORDS, n - begin);
+            bool cacheable = cache && count == ARCHIVE_BLOCK_RECORDS;
+            if (cacheable)
+                if (const DecodedBlock* hit = cache->find(file, b)) return hit->points;
+            in.clear();
+            in.seekg(sizeof(magic) + begin * sizeof(ArchiveRecord));
+            in.read(reinterpret_cast<char*>(records.data()), count * sizeof(ArchiveRecord));
+            size_t got = static_cast<size_t>(in.gcount()) / sizeof(ArchiveRecord);
+            std::vector<DataPoint> decoded;
+            decoded.reserve(got);
+            for (size_t k = 0; k < got; ++k)
+                decoded.push_back({records[k].temperature, records[k].pressure, static_cast<time_t>(records[k].timestamp)});
+            if (cacheable && got == count) return cache->insert(file, b, std::move(decoded))->points;
+            scratch = std::move(decoded);
+            return scratch;
+        };
+        for (size_t b = first / ARCHIVE_BLOCK_RECORDS; b * ARCHIVE_BLOCK_RECORDS < last; ++b) {
+            const auto& decoded = block(b);
+            size_t begin = b * ARCHIVE_BLOCK_RECORDS;
+            size_t end = std::min(last, begin + decoded.size());
+            for (size_t i = std::max(first, begin); i < end; ++i)
+                if ((i - first) % stride == 0) emit(decoded[i - begin]);
+            if (decoded.size() < ARCHIVE_BLOCK_RECORDS && end < last) break;
+        }
+        for (; pending < late.size(); ++pending) visit(late[pending]);
+        return extent;
+    }
+
+    static std::vector<DataPoint> read_late(const std::string& path, time_t from, time_t to) {
+        std::vector<DataPoint> points;
+        std::ifstream in(archive_late_path(path), std::ios::binary);
+        ArchiveRecord r{};
+        while (in.read(reinterpret_cast<char*>(&r), sizeof(r)))
+            if (r.timestamp >= from && r.timestamp <= to)
+                points.push_back({r.temperature, r.pressure, static_cast<time_t>(r.timestamp)});
+        std::stable_sort(points.begin(), points.end(),
+                         [](const DataPoint& a, const DataPoint& b) { return a.timestamp < b.timestamp; });
+        return points;
+    }
+
+    // Returns the archived samples with from <= timestamp <= to, at most limit of them (evenly strided).
+    static std::vector<DataPoint> read_range(const std::string& path, time_t from, time_t to, size_t limit,
+                                             BlockCache* cache = nullptr) {
+        std::vector<DataPoint> points;
+        if (limit > 0) scan(path, from, to, limit, cache, [&points](const DataPoint& p) { points.push_back(p); });
+        return points;
+    }
+};
+
+class StdoutSink : public OutputSink {
+public:
+    bool write(const SampleBatch& batch) override {
+        for (const auto& d : batch.points) {
+            float altitude = 44330.0f * (1.0f - std::pow(d.pressure / 1013.25f, 0.1903f));
+            std::cout << "Temp: " << d.temperature << " C, Press: " << d.pressure
+                      << " hPa, Alt: " << altitude << " m\n";
+        }
+        std::cout.flush();
+        return static_cast<bool>(std::cout);
+    }
+};
+
+class UdpSink : public OutputSink {
+    int sock = -1;
+    sockaddr_storage addr{};
+    socklen_t addr_len = 0;
+
+public:
+    explicit UdpSink(const std::string& target) {
+        size_t colon = target.rfind(':');
+        if (colon == std::string::npos) throw std::runtime_error("UDP sink needs host:port: " + target);
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_DGRAM;
+        addrinfo* result = nullptr;
+        if (getaddrinfo(target.substr(0, colon).c_str(), target.substr(colon + 1).c_str(), &hints, &result) != 0 || !result)
+            throw std::runtime_error("Failed to resolve UDP sink: " + target);
+        sock = socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+        std::memcpy(&addr, result->ai_addr, result->ai_addrlen);
+        addr_len = result->ai_addrlen;
+        freeaddrinfo(result);
+        if (sock == -1) throw std::runtime_error("Failed to create UDP socket: " + std::string(strerror(errno)));
+    }
+    ~UdpSink() override { if (sock != -1) close(sock); }
+    bool write(const SampleBatch& batch) override {
+        std::string datagram;
+        bool ok = true;
+        for (size_t i = 0; i < batch.points.size(); ++i) {
+            const auto& d = batch.points[i];
+            char line[64];
+            int n = snprintf(line, sizeof(line), "%.2f,%.2f,%lld\n", d.temperature, d.pressure, static_cast<long long>(d.timestamp));
+            datagram.append(line, n);
+            if (datagram.size() > 1200 || i + 1 == batch.points.size()) {
+                if (sendto(sock, datagram.data(), datagram.size(), 0, reinterpret_cast<sockaddr*>(&addr), addr_len) < 0) ok = false;
+                datagram.clear();
+            }
+        }
+        return ok;
+    }
+};
+
+class MetricsSink : public OutputSink {
+    Metrics& metrics;
+
+public:
+    explicit MetricsSink(Metrics& m) : metrics(m) {}
+    bool write(const SampleBatch& batch) override {
+        const auto& last = batch.points.back();
+        metrics.set("bmp280_temperature_celsius", last.temperature);
+        metrics.set("bmp280_pressure_hpa", last.pressure);
+        metrics.set("bmp280_last_sample_timestamp", static_cast<double>(last.timestamp));
+        metrics.add("bmp280_published_samples_total", static_cast<double>(batch.points.size()));
+        return true;
+    }
+};
+
+class SinkRunner {
+    std::string name;
+    std::unique_ptr<OutputSink> sink;
+    BroadcastRing& ring;
+    BroadcastRing::Subscription subscription;
+    std::atomic<uint64_t> cursor;
+    std::atomic<uint64_t> delivered{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> errors{0};
+    std::thread worker;
+
+    void run() {
+        uint64_t next = cursor;
+        uint64_t expected_seq = subscription.sample_seq;
+        while (auto batch = ring.wait(next, subscription.pin)) {
+            if (batch->first_seq > expected_seq) dropped += batch->first_seq - expected_seq;
+            expected_seq = batch->first_seq + batch->points.size();
+            if (!sink->write(*batch)) ++errors;
+            delivered += batch->points.size();
+            cursor = next;
+        }
+    }
+
+public:
+    SinkRunner(std::string sink_name, std::unique_ptr<OutputSink> output, BroadcastRing& broadcast)
+        : name(std::move(sink_name)), sink(std::move(output)), ring(broadcast),
+          subscription(broadcast.subscribe(sink->lossless())), cursor(subscription.cursor) {
+        worker = std::thread(&SinkRunner::run, this);
+    }
+    ~SinkRunner() {
+        if (worker.joinable()) worker.join();
+    }
+    SinkRunner(const SinkRunner&) = delete;
+    SinkRunner& operator=(const SinkRunner&) = delete;
+
+    const std::string& get_name() const { return name; }
+    uint64_t get_lag() const { return ring.get_head() - cursor; }
+    uint64_t get_delivered() const { return delivered; }
+    uint64_t get_dropped() const { return dropped; }
+    uint64_t get_errors() const { return errors; }
+};
+
+class SampleParser {
+public:
+    using SampleHandler = std::function<void(float temp, float press)>;
+    using ErrorHandler = std::function<void(const std::string& msg)>;
+
+private:
+    char buffer[BUFFER_SIZE] = {0};
+    size_t buf_pos = 0;
+    // A sample's Temp and Pressure lines may arrive in different reads.
+    float temp = 0.0f, press = 0.0f;
+    bool got_temp = false, got_press = false;
+    SampleHandler on_sample;
+    ErrorHandler on_error;
+
+    static bool parse_value(const std::string& line, float& value) {
+        size_t pos = line.find_first_of("-0123456789");
+        if (pos == std::string::npos) return false;
+        try {
+            value = std::stof(line.substr(pos));
+            return true;
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+
+    void process_line(const std::string& line) {
+        float value;
+        if (line.find("Temp") != std::string::npos && parse_value(line, value)) {
+            if (value >= -40.0f && value <= 85.0f) {
+                temp = value;
+                got_temp = true;
+            } else {
+                on_error("Invalid temperature: " + std::to_string(value));
+            }
+        } else if (line.find("Pres") != std::string::npos && parse_value(line, value)) {
+            if (value >= 300.0f && value <= 1100.0f) {
+                press = value;
+                got_press = true;
+            } else {
+                on_error("Invalid pressure: " + std::to_string(value));
+            }
+        }
+    }
+
+public:
+    SampleParser(SampleHandler sample_handler, ErrorHandler error_handler)
+        : on_sample(std::move(sample_handler)), on_error(std::move(error_handler)) {}
+
+    char* write_ptr() { return buffer + buf_pos; }
+    size_t free_space() const { return BUFFER_SIZE - buf_pos - 1; }
+
+    void commit(size_t len) {
+        buffer[buf_pos + len] = '\0';
+        std::string buf(buffer, buf_pos + len);
+        size_t pos = 0;
+        while (pos < buf.size()) {
+            size_t nl = buf.find('\n', pos);
+            if (nl == std::string::npos) break;
+            std::string line = buf.substr(pos, nl - pos);
+            pos = nl + 1;
+            process_line(line);
+            if (got_temp && got_press) {
+                on_sample(temp, press);
+                got_temp = got_press = false;
+            }
+        }
+
+        buf_pos = buf.size() - pos;
+        if (buf_pos > 0) {
+            std::memmove(buffer, buf.c_str() + pos, buf_pos);
+            buffer[buf_pos] = '\0';
+        } else {
+            buf_pos = 0;
+        }
+    }
+
+    void feed(const char* data, size_t len) {
+        while (len > 0) {
+            size_t n = std::min(len, free_space());
+            if (n == 0) {
+                buf_pos = 0;
+                continue;
+            }
+            std::memcpy(write_ptr(), data, n);
+            commit(n);
+            data += n;
+            len -= n;
+        }
+    }
+
+    void reset() {
+        buf_pos = 0;
+        got_temp = got_press = false;
+    }
+};
+
+// Monotonic microseconds for every interval and deadline; a clock step cannot make them wrap.
+uint64_t now_us() {
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000u + static_cast<uint64_t>(ts.tv_nsec / 1000);
+}
+
+// Wall-clock microseconds, only for timestamps that are stored, such as capture records.
+uint64_t wall_us() {
+    timespec ts{};
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000u + static_cast<uint64_t>(ts.tv_nsec / 1000);
+}
+
+double process_cpu_seconds() {
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0.0;
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+size_t process_rss_bytes() {
+    std::ifstream statm("/proc/self/statm");
+    size_t pages = 0, resident = 0;
+    if (!(statm >> pages >> resident)) return 0;
+    return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+void put_varint(std::string& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+bool get_varint(std::istream& in, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        int c = in.get();
+        if (c == EOF) return false;
+        v |= static_cast<uint64_t>(c & 0x7F) << shift;
+        if (!(c & 0x80)) return true;
+    }
+    return false;
+}
+
+static const char capture_magic[8] = {'B', 'M', 'P', 'C', 'A', 'P', '\n', 1};
+
+class CaptureReader {
+    std::ifstream in;
+    uint64_t time_us = 0;
+
+public:
+    explicit CaptureReader(const std::string& path) : in(path, std::ios::binary) {
+        char magic[sizeof(capture_magic)];
+        if (!in || !in.read(magic, sizeof(magic)) || std::memcmp(magic, capture_magic, sizeof(magic)) != 0)
+            throw std::runtime_error("Not a capture file: " + path);
+    }
+
+    bool next(uint64_t& chunk_us, std::string& bytes) {
+        uint64_t delta, len;
+        if (!get_varint(in, delta) || !get_varint(in, len) || len > BUFFER_SIZE) return false;
+        bytes.resize(len);
+        if (!in.read(bytes.data(), len)) return false;
+        time_us += delta;
+        chunk_us = time_us;
+        return true;
+    }
+
+    std::streamoff tell() { return in.tellg(); }
+};
+
+class CaptureWriter {
+    std::ofstream out;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::string pending;
+    uint64_t last_us = 0;
+    bool stopping = false;
+    std::atomic<size_t> dropped{0};
+    std::atomic<size_t> written{0};
+
+    void run() {
+        std::string batch;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            cv.wait(lock, [this] { return stopping || !pending.empty(); });
+            if (pending.empty() && stopping) break;
+            batch.swap(pending);
+            lock.unlock();
+            out.write(batch.data(), batch.size());
+            out.flush();
+            written += batch.size();
+            batch.clear();
+            lock.lock();
+        }
+    }
+
+public:
+    // Appends to an existing capture: read times continue from its last chunk, and a chunk cut short
+    // by a crash is truncated away so the new ones stay readable.
+    explicit CaptureWriter(const std::string& path) {
+        bool fresh = !std::filesystem::exists(path) || std::filesystem::file_size(path) == 0;
+        if (!fresh) {
+            CaptureReader reader(path);
+            uint64_t chunk_us;
+            std::string bytes;
+            std::streamoff end = sizeof(capture_magic);
+            while (reader.next(chunk_us, bytes)) {
+                last_us = chunk_us;
+                end = reader.tell();
+            }
+            std::filesystem::resize_file(path, end);
+        }
+        out.open(path, std::ios::binary | std::ios::app);
+        if (!out) throw std::runtime_error("Failed to open capture file: " + path);
+        if (fresh) out.write(capture_magic, sizeof(capture_magic));
+        worker = std::thread(&CaptureWriter::run, this);
+    }
+    ~CaptureWriter() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_one();
+        if (worker.joinable()) worker.join();
+    }
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+    void append(uint64_t time_us, const char* data, size_t len) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (pending.size() + len > CAPTURE_QUEUE_LIMIT) {
+                dropped += len;
+                return;
+            }
+            put_varint(pending, time_us - std::min(time_us, last_us));
+            put_varint(pending, len);
+            pending.append(data, len);
+            last_us = time_us;
+        }
+        cv.notify_one();
+    }
+
+    size_t get_dropped() const { return dropped; }
+    size_t get_written() const { return written; }
+};
+
+enum class FlowControl { Off, RtsCts, XonXoff };
+
+std::optional<FlowControl> parse_flow_control(const std::string& name) {
+    if (name == "none") return FlowControl::Off;
+    if (name == "rtscts") return FlowControl::RtsCts;
+    if (name == "xonxoff") return FlowControl::XonXoff;
+    return std::nullopt;
+}
+
+class SerialPort {
+    int fd;
+public:
+    SerialPort(const std::string& port, speed_t baud, FlowControl flow = FlowControl::Off) : fd(-1) {
+        fd = open(port.c_str(), O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if (fd == -1) throw std::runtime_error("Failed to open serial port: " + port);
+
+        termios tty{};
+        if (tcgetattr(fd, &tty) != 0) {
+            close(fd);
+            throw std::runtime_error("Failed to get serial attributes");
+        }
+        cfsetispeed(&tty, baud);
+        cfsetospeed(&tty, baud);
+        tty.c_cflag |= (CLOCAL | CREAD);
+        tty.c_cflag &= ~CSIZE;
+        tty.c_cflag |= CS8;
+        tty.c_cflag &= ~(PARENB | CSTOPB | CRTSCTS);
+        tty.c_lflag &= ~(ICANON | ECHO | ECHOE | ISIG);
+        tty.c_iflag &= ~(IXON | IXOFF | IXANY);
+        tty.c_oflag &= ~OPOST;
+        if (flow == FlowControl::RtsCts) tty.c_cflag |= CRTSCTS;
+        if (flow == FlowControl::XonXoff) tty.c_iflag |= IXON | IXOFF;
+        tty.c_cc[VMIN] = 0;
+        tty.c_cc[VTIME] = 1;
+
+        if (tcsetattr(fd, TCSANOW, &tty) != 0) {
+            close(fd);
+            throw std::runtime_error("Failed to set serial attributes");
+        }
+    }
+    ~SerialPort() { if (fd != -1) close(fd); }
+    int get() const { return fd; }
+    UartCounters counters() const {
+        UartCounters c;
+        if (fd == -1) return c;
+        ioctl(fd, FIONREAD, &c.queued);
+#ifdef TIOCGICOUNT
+        serial_icounter_struct icount{};
+        if (ioctl(fd, TIOCGICOUNT, &icount) == 0) {
+            c.has_icount = true;
+            c.rx = icount.rx;
+            c.overrun = icount.overrun;
+            c.frame = icount.frame;
+            c.parity = icount.parity;
+            c.brk = icount.brk;
+            c.buf_overrun = icount.buf_overrun;
+        }
+#endif
+        return c;
+    }
+    void close_port() { if (fd != -1) { close(fd); fd = -1; } }
+};
+
+class X11Display {
+    Display* dpy = nullptr;
+    Window win = 0;
+    GC gc = 0;
+    Pixmap pixmap = 0;
+
+    void cleanup() {
+        if (pixmap) { XFreePixmap(dpy, pixmap); pixmap = 0; }
+        if (gc) { XFreeGC(dpy, gc); gc = 0; }
+        if (win) { XDestroyWindow(dpy, win); win = 0; }
+        if (dpy) { XCloseDisplay(dpy); dpy = nullptr; }
+    }
+
+public:
+    X11Display() {
+        dpy = XOpenDisplay(nullptr);
+        if (!dpy) throw std::runtime_error("Cannot open display");
+
+        int screen = DefaultScreen(dpy);
+        win = XCreateSimpleWindow(dpy, RootWindow(dpy, screen), 10, 10, WIDTH, HEIGHT, 1,
+                                  BlackPixel(dpy, screen), WhitePixel(dpy, screen));
+        XStoreName(dpy, win, "BMP280 Sensor Monitor");
+
+        XWMHints* wm_hints = XAllocWMHints();
+        if (wm_hints) {
+            wm_hints->flags = StateHint;
+            wm_hints->initial_state = NormalState;
+            XSetWMHints(dpy, win, wm_hints);
+            XFree(wm_hints);
+        }
+
+        XSelectInput(dpy, win, ExposureMask | KeyPressMask | ButtonPressMask | ButtonReleaseMask | PointerMotionMask |
+                                   VisibilityChangeMask | StructureNotifyMask);
+        XMapWindow(dpy, win);
+        gc = XCreateGC(dpy, win, 0, nullptr);
+        XSetForeground(dpy, gc, BlackPixel(dpy, screen));
+
+        pixmap = XCreatePixmap(dpy, win, WIDTH, HEIGHT, DefaultDepth(dpy, screen));
+        XSetForeground(dpy, gc, WhitePixel(dpy, screen));
+        XFillRectangle(dpy, pixmap, gc, 0, 0, WIDTH, HEIGHT);
+    }
+    ~X11Display() { cleanup(); }
+    X11Display(const X11Display&) = delete;
+    X11Display& operator=(const X11Display&) = delete;
+    Display* get_display() const { return dpy; }
+    Window get_window() const { return win; }
+    GC get_gc() const { return gc; }
+    Pixmap get_pixmap() const { return pixmap; }
+};
+
+constexpr std::array<std::string_view, 16> help_lines = {
+    "Keyboard Shortcuts:",
+    "q: Quit",
+    "s: Save data to file",
+    "p: Pause/Resume",
+    "c: Clear errors",
+    "b: Change baud rate",
+    "+/-: Horizontal zoom in/out",
+    "Up/Down: Vertical zoom in/out",
+    "Left/Right: Scroll graph",
+    "o: Long-range overview",
+    "t: Toggle theme",
+    "m: Find motifs/discords",
+    "a: Time-weighted averages",
+    "Shift+drag: Range statistics",
+    "i: Show/hide HUD",
+    "h: Show/hide this help"
+};
+
+// Rendered overview tiles are kept under TILE_DIR as run-length encoded pixels. The name starts with
+// the resolution level and tile index so every variant of a tile can be removed when late data lands in it.
+static const char tile_magic[8] = {'B', 'M', 'P', 'T', 'I', 'L', 'E', 1};
+
+std::string tile_prefix(int level, int64_t index) {
+    char name[48];
+    snprintf(name, sizeof(name), "L%02d_T%lld_", level, static_cast<long long>(index));
+    return name;
+}
+
+std::string tile_path(int level, int64_t index, uint64_t key) {
+    char hex[20];
+    snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(key));
+    return std::string(TILE_DIR "/") + tile_prefix(level, index) + hex + ".tile";
+}
+
+// Seconds after a tile's end before it can be cached: rollup buckets may still be open, and the
+// archive writer runs behind ingest.
+time_t tile_slack(time_t seconds_per_pixel) {
+    return seconds_per_pixel >= 3600 ? 86400 : 60;
+}
+
+// Per-pixel aggregates of both channels for an archive-backed tile. Every sample is visited so the
+// min/max envelope keeps its extremes; uncached, so a long scan does not evict the blocks behind the
+// raw views. Returns whether the archive covers the whole tile.
+bool archive_tile_columns(const std::string& path, time_t t0, time_t spp, std::array<std::vector<Aggregate>, 2>& columns) {
+    time_t t1 = t0 + spp * TILE_WIDTH;
+    columns[0].assign(TILE_WIDTH, Aggregate{});
+    columns[1].assign(TILE_WIDTH, Aggregate{});
+    auto extent = ArchiveReader::scan(path, t0, t1 - 1, 0, nullptr, [&](const DataPoint& p) {
+        columns[0][(p.timestamp - t0) / spp].add_sample(p.temperature);
+        columns[1][(p.timestamp - t0) / spp].add_sample(p.pressure);
+    });
+    return extent && extent->first <= t0 && extent->second >= t1;
+}
+
+// What one frame shows, captured on the event thread from the viewport and the visible history span.
+// Once published it is only read by the render thread, so neither side needs a lock to use it.
+struct FrameState {
+    struct Mark {
+        int i0, i1, rank;
+        bool is_motif;
+    };
+    // One TILE_WIDTH-pixel column range of the overview. Columns are only filled when the tile is not
+    // expected in the cache; x is the tile's left edge relative to the plot and may be negative.
+    struct Tile {
+        int level = 0;
+        int64_t index = 0;
+        uint64_t key = 0;
+        int x = 0;
+        bool cacheable = false;
+        std::vector<Aggregate> columns;
+    };
+    struct Series {
+        bool is_temp = true;
+        int max_points = 0;
+        float min_val = 0.0f, max_val = 1.0f;
+        float threshold = 0.0f;
+        unsigned long color_low = 0, color_high = 0;
+        time_t start_time = 0, end_time = 0;
+        std::vector<float> values;
+        std::vector<std::string> value_labels;
+        std::vector<std::string> time_labels;
+        std::vector<std::pair<int, Envelope>> envelopes;
+        std::shared_ptr<const std::vector<DataPoint>> raw;
+        std::vector<Mark> marks;
+        std::optional<std::pair<int, int>> selection;
+        bool overview = false;
+        std::vector<Tile> tiles;
+    };
+
+    std::array<Series, 2> graphs;
+    std::string menu_status;
+    bool menu_highlighted = false;
+    std::string footer;
+    std::vector<std::string> selection_lines;
+    bool selection_is_temp = true;
+    std::vector<std::string> hud_lines;
+    std::vector<std::string> errors;
+    bool show_help = false;
+    int selected_help_item = -1;
+    int point_stride = 1;
+    std::array<unsigned long, 4> colors{};
+    unsigned long background = 0, text = 0, grid = 0, envelope = 0;
+    unsigned long menu_bg = 0, menu_text = 0, menu_highlight = 0, help_bg = 0, keybind = 0;
+    bool full = true;
+    uint64_t input_time_us = 0;
+};
+
+// Draws frames on its own thread and its own X connection into the window's back buffer, so a heavy
+// frame never delays event handling or ingest. Frames are handed over by swapping a pointer: one
+// published while the previous is still pending replaces it, and the renderer always draws the newest.
+class FrameRenderer {
+public:
+    struct Stats {
+        uint64_t frames, menu_redraws, superseded, last_cost_us;
+        uint64_t latency_sum_us, latency_count, latency_max_us;
+        uint64_t tile_hits, tile_loads, tile_renders, tile_live_renders, tile_holes, tiles_cached;
+        uint64_t repairs, repaired_pixels;
+    };
+
+private:
+    Display* dpy = nullptr;
+    Window win;
+    Pixmap pixmap;
+    GC gc = 0;
+    XFontStruct* regular_font = nullptr;
+    XFontStruct* bold_font = nullptr;
+    unsigned long current_fg = 0;
+    std::optional<unsigned long> window_background;
+    int wake_fd = -1;
+    std::atomic<FrameState*> pending{nullptr};
+    std::atomic<bool> stopping{false};
+    std::atomic<uint64_t> frames{0}, menu_redraws{0}, superseded{0}, last_cost_us{0};
+    std::atomic<uint64_t> latency_sum_us{0}, latency_count{0}, latency_max_us{0};
+    std::atomic<uint64_t> tile_hits{0}, tile_loads{0}, tile_renders{0}, tile_live_renders{0}, tile_holes{0}, tiles_cached{0};
+    std::atomic<uint64_t> repairs{0}, repaired_pixels{0};
+    std::mutex damage_mutex;
+    Region damage = nullptr;
+    struct CachedTile {
+        Pixmap pixmap;
+        uint64_t last_used;
+    };
+    std::map<uint64_t, CachedTile> tiles;
+    uint64_t tile_clock = 0;
+    size_t tile_bytes = 0;
+    std::atomic<size_t> tile_limit{TILE_CACHE_TILES};
+    std::mutex stored_mutex;
+    std::vector<uint64_t> stored_tiles;
+    Pixmap scratch = 0;
+    std::thread thread;
+
+    void cleanup() {
+        if (wake_fd != -1) { close(wake_fd); wake_fd = -1; }
+        if (damage) { XDestroyRegion(damage); damage = nullptr; }
+        for (auto& [key, tile] : tiles) XFreePixmap(dpy, tile.pixmap);
+        tiles.clear();
+        if (scratch) { XFreePixmap(dpy, scratch); scratch = 0; }
+        if (regular_font && regular_font != bold_font) XFreeFont(dpy, regular_font);
+        if (bold_font) XFreeFont(dpy, bold_font);
+        regular_font = bold_font = nullptr;
+        if (gc) { XFreeGC(dpy, gc); gc = 0; }
+        if (dpy) { XCloseDisplay(dpy); dpy = nullptr; }
+    }
+
+    void wake() {
+        uint64_t one = 1;
+        if (write(wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) std::cerr << "Render wakeup failed: " << strerror(errno) << "\n";
+    }
+
+    void run() {
+        while (!stopping) {
+            pollfd p = {wake_fd, POLLIN, 0};
+            poll(&p, 1, 200);
+            uint64_t count;
+            if (read(wake_fd, &count, sizeof(count)) < 0 && errno != EAGAIN) break;
+            std::unique_ptr<FrameState> frame(pending.exchange(nullptr, std::memory_order_acquire));
+            Region exposed = take_damage();
+            trim_tiles();
+            if (!frame) {
+                repair(exposed);
+                continue;
+            }
+            uint64_t t0 = now_us();
+            if (frame->full) {
+                XDestroyRegion(exposed);
+                render(*frame);
+            } else {
+                draw_menu_bar(*frame);
+                XCopyArea(dpy, pixmap, win, gc, 0, 0, WIDTH, MENU_HEIGHT, 0, 0);
+                repair(exposed);
+            }
+            XSync(dpy, False);
+            uint64_t done = now_us();
+            if (frame->full) {
+                last_cost_us = done - t0;
+                ++frames;
+            }
+            if (frame->input_time_us != 0 && done > frame->input_time_us) {
+                uint64_t latency = done - frame->input_time_us;
+                latency_sum_us += latency;
+                ++latency_count;
+                if (latency > latency_max_us) latency_max_us = latency;
+            }
+        }
+    }
+
+    Region take_damage() {
+        Region taken = XCreateRegion();
+        std::lock_guard<std::mutex> lock(damage_mutex);
+        std::swap(taken, damage);
+        return taken;
+    }
+
+    // Copies only the exposed area from the back buffer. Only this thread draws into the back buffer, so
+    // the copy never shows a half-drawn frame.
+    void repair(Region exposed) {
+        if (!XEmptyRegion(exposed)) {
+            XRectangle box;
+            XClipBox(exposed, &box);
+            XSetRegion(dpy, gc, exposed);
+            XCopyArea(dpy, pixmap, win, gc, box.x, box.y, box.width, box.height, box.x, box.y);
+            XSetClipMask(dpy, gc, None);
+            XFlush(dpy);
+            ++repairs;
+            repaired_pixels += static_cast<uint64_t>(box.width) * box.height;
+        }
+        XDestroyRegion(exposed);
+    }
+
+    void set_foreground(unsigned long color) {
+        if (color != current_fg) {
+            XSetForeground(dpy, gc, color);
+            current_fg = color;
+        }
+    }
+
+    // A theme change reaches the window only here, so the back buffer is never touched off this thread.
+    void render(const FrameState& f) {
+        if (window_background != f.background) {
+            XSetWindowBackground(dpy, win, f.background);
+            window_background = f.background;
+        }
+        set_foreground(f.background);
+        XFillRectangle(dpy, pixmap, gc, 0, 0, WIDTH, HEIGHT);
+        draw_menu_bar(f);
+        draw_graph(f, f.graphs[0], 100, 40, 600, 200);
+        draw_graph(f, f.graphs[1], 100, 290, 600, 200);
+        draw_footer(f);
+        draw_selection_stats(f);
+        draw_hud(f);
+        draw_errors(f);
+        draw_help(f);
+        XCopyArea(dpy, pixmap, win, gc, 0, 0, WIDTH, HEIGHT, 0, 0);
+    }
+
+    void draw_menu_bar(const FrameState& f) {
+        set_foreground(f.menu_highlighted ? f.menu_highlight : f.menu_bg);
+        XFillRectangle(dpy, pixmap, gc, 0, 0, WIDTH, MENU_HEIGHT);
+        set_foreground(f.menu_text);
+        XDrawString(dpy, pixmap, gc, 10, 20, f.menu_status.c_str(), f.menu_status.length());
+        ++menu_redraws;
+    }
+
+    void render_tile(Pixmap target, const FrameState& f, const FrameState::Series& s, const FrameState::Tile& t) {
+        set_foreground(f.background);
+        XFillRectangle(dpy, target, gc, 0, 0, TILE_WIDTH, TILE_HEIGHT);
+        auto to_y = [&](float v) {
+            return std::clamp(TILE_HEIGHT - static_cast<int>((v - s.min_val) / (s.max_val - s.min_val) * TILE_HEIGHT), 0, TILE_HEIGHT);
+        };
+        std::vector<XPoint> line;
+        set_foreground(f.envelope);
+        for (int c = 0; c < static_cast<int>(t.columns.size()); ++c) {
+            const Aggregate& a = t.columns[c];
+            if (a.count == 0) continue;
+            XDrawLine(dpy, target, gc, c, to_y(a.min), c, to_y(a.max));
+            line.push_back({static_cast<short>(c), static_cast<short>(to_y(a.mean()))});
+        }
+        set_foreground(s.color_low);
+        if (line.size() >= 2) XDrawLines(dpy, target, gc, line.data(), static_cast<int>(line.size()), CoordModeOrigin);
+        else if (line.size() == 1) XDrawPoint(dpy, target, gc, line[0].x, line[0].y);
+    }
+
+    bool save_tile(const std::string& path, Pixmap tile) {
+        XImage* image = XGetImage(dpy, tile, 0, 0, TILE_WIDTH, TILE_HEIGHT, AllPlanes, ZPixmap);
+        if (!image) return false;
+        BinaryWriter out;
+        for (char c : tile_magic) out.put(c);
+        uint32_t run_pixel = 0;
+        uint16_t run = 0;
+        for (int y = 0; y < TILE_HEIGHT; ++y) {
+            for (int x = 0; x < TILE_WIDTH; ++x) {
+                uint32_t pixel = static_cast<uint32_t>(XGetPixel(image, x, y));
+                if (run > 0 && (pixel != run_pixel || run == UINT16_MAX)) {
+                    out.put(run);
+                    out.put(run_pixel);
+                    run = 0;
+                }
+                run_pixel = pixel;
+                ++run;
+            }
+        }
+        out.put(run);
+        out.put(run_pixel);
+        XDestroyImage(image);
+        return write_file_atomic(path, out.str());
+    }
+
+    Pixmap load_tile(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if (data.size() < sizeof(tile_magic) || std::memcmp(data.data(), tile_magic, sizeof(tile_magic)) != 0) return 0;
+        int screen = DefaultScreen(dpy);
+        XImage* image = XCreateImage(dpy, DefaultVisual(dpy, screen), DefaultDepth(dpy, screen), ZPixmap, 0, nullptr,
+                                     TILE_WIDTH, TILE_HEIGHT, 32, 0);
+        if (!image) return 0;
+        image->data = static_cast<char*>(malloc(static_cast<size_t>(image->bytes_per_line) * TILE_HEIGHT));
+        BinaryReader reader(data, sizeof(tile_magic));
+        int filled = 0;
+        while (image->data && filled < TILE_WIDTH * TILE_HEIGHT) {
+            uint16_t run = reader.get<uint16_t>();
+            uint32_t pixel = reader.get<uint32_t>();
+            if (!reader.good() || run == 0) break;
+            for (int end = std::min(filled + run, TILE_WIDTH * TILE_HEIGHT); filled < end; ++filled)
+                XPutPixel(image, filled % TILE_WIDTH, filled / TILE_WIDTH, pixel);
+        }
+        Pixmap tile = 0;
+        if (filled == TILE_WIDTH * TILE_HEIGHT) {
+            tile = XCreatePixmap(dpy, pixmap, TILE_WIDTH, TILE_HEIGHT, DefaultDepth(dpy, screen));
+            XPutImage(dpy, tile, gc, image, 0, 0, 0, 0, TILE_WIDTH, TILE_HEIGHT);
+        }
+        XDestroyImage(image);
+        return tile;
+    }
+
+    void trim_tiles() {
+        while (tiles.size() > tile_limit) {
+            auto oldest = std::min_element(tiles.begin(), tiles.end(),
+                                           [](const auto& a, const auto& b) { return a.second.last_used < b.second.last_used; });
+            XFreePixmap(dpy, oldest->second.pixmap);
+            tiles.erase(oldest);
+        }
+        tiles_cached = tiles.size();
+    }
+
+    void remember_tile(uint64_t key, Pixmap tile) {
+        auto& slot = tiles[key];
+        if (slot.pixmap) XFreePixmap(dpy, slot.pixmap);
+        slot = {tile, ++tile_clock};
+        trim_tiles();
+    }
+
+    // Memory first, then disk; sealed tiles sent with columns are drawn once and stored in both.
+    Pixmap tile_pixmap(const FrameState& f, const FrameState::Series& s, const FrameState::Tile& t) {
+        if (t.columns.empty()) {
+            auto it = tiles.find(t.key);
+            if (it != tiles.end()) {
+                it->second.last_used = ++tile_clock;
+                ++tile_hits;
+                return it->second.pixmap;
+            }
+            Pixmap tile = load_tile(tile_path(t.level, t.index, t.key));
+            if (tile) {
+                remember_tile(t.key, tile);
+                ++tile_loads;
+            }
+            return tile;
+        }
+        if (!t.cacheable) {
+            render_tile(scratch, f, s, t);
+            ++tile_live_renders;
+            return scratch;
+        }
+        auto cached = tiles.find(t.key);
+        if (cached != tiles.end()) {
+            cached->second.last_used = ++tile_clock;
+            ++tile_hits;
+            return cached->second.pixmap;
+        }
+        Pixmap tile = XCreatePixmap(dpy, pixmap, TILE_WIDTH, TILE_HEIGHT, DefaultDepth(dpy, DefaultScreen(dpy)));
+        render_tile(tile, f, s, t);
+        if (save_tile(tile_path(t.level, t.index, t.key), tile)) {
+            std::lock_guard<std::mutex> lock(stored_mutex);
+            stored_tiles.push_back(t.key);
+        }
+        remember_tile(t.key, tile);
+        ++tile_renders;
+        return tile;
+    }
+
+    void draw_tiles(const FrameState& f, const FrameState::Series& s, int x, int y, int w) {
+        for (const auto& t : s.tiles) {
+            Pixmap tile = tile_pixmap(f, s, t);
+            if (!tile) {
+                ++tile_holes;
+                continue;
+            }
+            int src_x = std::max(0, -t.x);
+            int width = std::min(TILE_WIDTH, w - t.x) - src_x;
+            if (width > 0) XCopyArea(dpy, tile, pixmap, gc, src_x, 0, width, TILE_HEIGHT, x + t.x + src_x, y);
+        }
+    }
+
+    void draw_graph(const FrameState& f, const FrameState::Series& s, int x, int y, int w, int h) {
+        if (s.values.size() < 2 && !s.overview) return;
+        int max_points = s.max_points;
+        float min_val = s.min_val, max_val = s.max_val;
+        if (s.overview) draw_tiles(f, s, x, y, w);
+
+        set_foreground(f.grid);
+        for (int i = 1; i < 5; ++i) {
+            int y_pos = y + i * h / 5;
+            XDrawLine(dpy, pixmap, gc, x, y_pos, x + w, y_pos);
+            int x_pos = x + i * w / 5;
+            XDrawLine(dpy, pixmap, gc, x_pos, y, x_pos, y + h);
+        }
+
+        set_foreground(f.text);
+        XDrawRectangle(dpy, pixmap, gc, x, y, w, h);
+
+        auto to_y = [&](float v) { return std::clamp(y + h - static_cast<int>((v - min_val) / (max_val - min_val) * h), y, y + h); };
+        if (s.raw) {
+            const auto& raw = *s.raw;
+            std::vector<XPoint> line(raw.size());
+            for (size_t i = 0; i < raw.size(); ++i) {
+                line[i].x = static_cast<short>(x + i * w / (raw.size() - 1));
+                line[i].y = static_cast<short>(to_y(s.is_temp ? raw[i].temperature : raw[i].pressure));
+            }
+            set_foreground(s.color_low);
+            XDrawLines(dpy, pixmap, gc, line.data(), static_cast<int>(line.size()), CoordModeOrigin);
+        }
+        for (const auto& [i, e] : s.envelopes) {
+            int ch = s.is_temp ? 0 : 1;
+            int xi = x + i * w / max_points;
+            set_foreground(f.envelope);
+            XDrawLine(dpy, pixmap, gc, xi, to_y(e.min[ch]), xi, to_y(e.max[ch]));
+        }
+        int stride = f.point_stride;
+        for (size_t i = stride; !s.raw && i < s.values.size(); i += stride) {
+            float val0 = s.values[i - stride];
+            float val1 = s.values[i];
+            int x0 = x + static_cast<int>(i - stride) * w / max_points;
+            int x1 = x + static_cast<int>(i) * w / max_points;
+            set_foreground(s.is_temp ? (val1 > s.threshold ? s.color_high : s.color_low)
+                                     : (std::abs(val1 - val0) > 1.0f ? s.color_high : s.color_low));
+            XDrawLine(dpy, pixmap, gc, x0, to_y(val0), x1, to_y(val1));
+        }
+
+        set_foreground(f.text);
+        for (size_t i = 0; i < s.value_labels.size(); ++i) {
+            int y_pos = y + h - static_cast<int>(i) * h / 5;
+            XDrawLine(dpy, pixmap, gc, x - 5, y_pos, x, y_pos);
+            XDrawString(dpy, pixmap, gc, x - 50, y_pos + 4, s.value_labels[i].c_str(), s.value_labels[i].length());
+        }
+
+        for (size_t i = 0; i < s.time_labels.size(); ++i) {
+            int x_pos = x + static_cast<int>(i) * w / 5;
+            XDrawString(dpy, pixmap, gc, x_pos - 20, y + h + 15, s.time_labels[i].c_str(), s.time_labels[i].length());
+        }
+
+        for (const auto& m : s.marks) {
+            int x0 = x + std::max(0, m.i0) * w / max_points;
+            int x1 = x + std::min(max_points - 1, m.i1) * w / max_points;
+            char tag[8];
+            snprintf(tag, sizeof(tag), "%c%d", m.is_motif ? 'M' : 'D', m.rank);
+            set_foreground(m.is_motif ? f.keybind : f.colors[1]);
+            XDrawLine(dpy, pixmap, gc, x0, y + h - 4, x1, y + h - 4);
+            XDrawLine(dpy, pixmap, gc, x0, y + h - 8, x0, y + h);
+            XDrawLine(dpy, pixmap, gc, x1, y + h - 8, x1, y + h);
+            XDrawString(dpy, pixmap, gc, x0 + 2, y + h - 10, tag, strlen(tag));
+        }
+
+        if (s.selection) {
+            int x0 = x + std::max(0, s.selection->first) * w / max_points;
+            int x1 = x + std::min(max_points - 1, s.selection->second) * w / max_points;
+            set_foreground(f.menu_highlight);
+            XDrawRectangle(dpy, pixmap, gc, x0, y + 1, std::max(1, x1 - x0), h - 2);
+        }
+
+        set_foreground(f.text);
+        const char* label = s.is_temp ? "Temperature" : "Pressure";
+        XDrawString(dpy, pixmap, gc, x + 10, y + 15, label, strlen(label));
+        set_foreground(s.color_low);
+        XDrawLine(dpy, pixmap, gc, x + 100, y + 10, x + 120, y + 10);
+        if (s.is_temp) {
+            set_foreground(s.color_high);
+            XDrawLine(dpy, pixmap, gc, x + 130, y + 10, x + 150, y + 10);
+        }
+    }
+
+    void draw_footer(const FrameState& f) {
+        if (f.footer.empty()) return;
+        set_foreground(f.text);
+        XDrawString(dpy, pixmap, gc, 20, HEIGHT - 20, f.footer.c_str(), f.footer.length());
+    }
+
+    void draw_box(const FrameState& f, const std::vector<std::string>& lines, int box_x, int box_y, int box_w, int box_h) {
+        set_foreground(f.help_bg);
+        XFillRectangle(dpy, pixmap, gc, box_x, box_y, box_w, box_h);
+        set_foreground(f.text);
+        XDrawRectangle(dpy, pixmap, gc, box_x, box_y, box_w - 1, box_h - 1);
+        for (size_t i = 0; i < lines.size(); ++i)
+            XDrawString(dpy, pixmap, gc, box_x + 10, box_y + 16 + static_cast<int>(i) * 15, lines[i].c_str(), lines[i].length());
+    }
+
+    int text_width(const std::vector<std::string>& lines) const {
+        int width = 0;
+        for (const auto& l : lines) width = std::max(width, XTextWidth(regular_font, l.c_str(), l.length()));
+        return width + 20;
+    }
+
+    void draw_selection_stats(const FrameState& f) {
+        if (f.selection_lines.empty()) return;
+        int box_w = text_width(f.selection_lines);
+        draw_box(f, f.selection_lines, 700 - box_w - 5, f.selection_is_temp ? 45 : 295, box_w, 55);
+    }
+
+    void draw_hud(const FrameState& f) {
+        if (f.hud_lines.empty()) return;
+        draw_box(f, f.hud_lines, 105, 45, text_width(f.hud_lines), static_cast<int>(f.hud_lines.size()) * 15 + 10);
+    }
+
+    void draw_errors(const FrameState& f) {
+        set_foreground(f.colors[0]);
+        int y = 40;
+        for (const auto& msg : f.errors) {
+            XDrawString(dpy, pixmap, gc, 10, y, msg.c_str(), msg.length());
+            y += 15;
+        }
+    }
+
+    void draw_help(const FrameState& f) {
+        if (!f.show_help) return;
+
+        const int line_height = 15;
+        const int padding = 10;
+
+        int max_width = 0;
+        for (const auto& line : help_lines) {
+            int width = XTextWidth(regular_font, line.data(), line.length());
+            if (width > max_width) max_width = width;
         }
         int total_height = help_lines.size() * line_height;
         int rect_width = max_width + 2 * padding;
         int rect_height = total_height + 2 * padding;
 
-        int start_x = WIDTH / 2 - rect_width / 2;
-        int start_y = HEIGHT / 2 - rect_height / 2;
+        int start_x = WIDTH / 2 - rect_width / 2;
+        int start_y = HEIGHT / 2 - rect_height / 2;
+
+        set_foreground(f.help_bg);
+        XFillRectangle(dpy, pixmap, gc, start_x, start_y, rect_width, rect_height);
+
+        set_foreground(f.text);
+        XDrawRectangle(dpy, pixmap, gc, start_x, start_y, rect_width - 1, rect_height - 1);
+
+        int y = start_y + padding + line_height - 5;
+        for (size_t i = 0; i < help_lines.size(); ++i) {
+            const auto& line = help_lines[i];
+            int text_width = XTextWidth(i == 0 ? bold_font : regular_font, line.data(), line.length());
+            int text_x = start_x + (rect_width - text_width) / 2;
+
+            if (static_cast<int>(i) == f.selected_help_item) {
+                set_foreground(f.menu_highlight);
+                XFillRectangle(dpy, pixmap, gc, start_x + padding, y - line_height + 5, rect_width - 2 * padding, line_height);
+            }
+
+            if (i == 0) {
+                XSetFont(dpy, gc, bold_font->fid);
+                set_foreground(f.text);
+                XDrawString(dpy, pixmap, gc, text_x, y, line.data(), line.length());
+            } else {
+                XSetFont(dpy, gc, regular_font->fid);
+                std::string str(line);
+                size_t colon_pos = str.find(": ");
+                if (colon_pos != std::string::npos) {
+                    std::string keybind = str.substr(0, colon_pos);
+                    std::string desc = str.substr(colon_pos + 2);
+                    set_foreground(f.keybind);
+                    XDrawString(dpy, pixmap, gc, text_x, y, keybind.c_str(), keybind.length());
+                    set_foreground(f.text);
+                    XDrawString(dpy, pixmap, gc, text_x + XTextWidth(regular_font, keybind.c_str(), keybind.length()) + 5, y, desc.c_str(), desc.length());
+                } else {
+                    set_foreground(f.text);
+                    XDrawString(dpy, pixmap, gc, text_x, y, line.data(), line.length());
+                }
+            }
+            y += line_height;
+        }
+    }
+
+public:
+    FrameRenderer(Window win, Pixmap pixmap) : win(win), pixmap(pixmap) {
+        dpy = XOpenDisplay(nullptr);
+        if (!dpy) throw std::runtime_error("Cannot open render connection");
+        gc = XCreateGC(dpy, pixmap, 0, nullptr);
+        regular_font = XLoadQueryFont(dpy, "fixed");
+        if (!regular_font) regular_font = XLoadQueryFont(dpy, "6x13");
+        bold_font = XLoadQueryFont(dpy, "-*-helvetica-bold-r-*-*-12-*-*-*-*-*-*-*");
+        if (!bold_font) bold_font = regular_font;
+        wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        damage = XCreateRegion();
+        int depth = DefaultDepth(dpy, DefaultScreen(dpy)), formats = 0;
+        scratch = XCreatePixmap(dpy, pixmap, TILE_WIDTH, TILE_HEIGHT, depth);
+        tile_bytes = static_cast<size_t>(TILE_WIDTH) * TILE_HEIGHT * sizeof(uint32_t);
+        if (XPixmapFormatValues* f = XListPixmapFormats(dpy, &formats)) {
+            for (int i = 0; i < formats; ++i) {
+                if (f[i].depth != depth) continue;
+                int pad = f[i].scanline_pad;
+                tile_bytes = static_cast<size_t>((TILE_WIDTH * f[i].bits_per_pixel + pad - 1) / pad * pad / 8) * TILE_HEIGHT;
+            }
+            XFree(f);
+        }
+        std::error_code ec;
+        std::filesystem::create_directories(TILE_DIR, ec);
+        if (!regular_font || wake_fd == -1) {
+            cleanup();
+            throw std::runtime_error("Failed to initialize renderer");
+        }
+        XSetFont(dpy, gc, regular_font->fid);
+        thread = std::thread(&FrameRenderer::run, this);
+    }
+    ~FrameRenderer() {
+        stopping = true;
+        wake();
+        thread.join();
+        delete pending.exchange(nullptr);
+        cleanup();
+    }
+    FrameRenderer(const FrameRenderer&) = delete;
+    FrameRenderer& operator=(const FrameRenderer&) = delete;
+
+    // Event thread only. A frame still waiting is superseded; the scene is redrawn if either asked for it.
+    void publish(std::unique_ptr<FrameState> frame) {
+        std::unique_ptr<FrameState> stale(pending.exchange(nullptr, std::memory_order_acquire));
+        if (stale) {
+            frame->full = frame->full || stale->full;
+            if (frame->input_time_us == 0) frame->input_time_us = stale->input_time_us;
+            ++superseded;
+        }
+        pending.store(frame.release(), std::memory_order_release);
+        wake();
+    }
+
+    // Event thread only. Queues an exposed area for the render thread to copy from the back buffer.
+    void expose(const XExposeEvent& e) {
+        XRectangle rect = {static_cast<short>(e.x), static_cast<short>(e.y),
+                           static_cast<unsigned short>(e.width), static_cast<unsigned short>(e.height)};
+        {
+            std::lock_guard<std::mutex> lock(damage_mutex);
+            XUnionRectWithRegion(&rect, damage, damage);
+        }
+        if (e.count == 0) wake();
+    }
+
+    // Keys of the tiles written to disk since the last call; only these may be sent without columns.
+    std::vector<uint64_t> take_stored_tiles() {
+        std::vector<uint64_t> keys;
+        std::lock_guard<std::mutex> lock(stored_mutex);
+        keys.swap(stored_tiles);
+        return keys;
+    }
+
+    // Server-side pixmaps plus the map nodes. Tiles above the limit count as gone: the render thread frees
+    // them before its next frame.
+    size_t tile_memory() const {
+        size_t cached = std::min<size_t>(tiles_cached, tile_limit);
+        return (cached + 1) * tile_bytes + cached * (sizeof(std::pair<const uint64_t, CachedTile>) + 4 * sizeof(void*));
+    }
+
+    // Halves the tile cache, keeping enough for both graphs on screen; evicted tiles are reloaded from disk.
+    bool shrink_tiles() {
+        size_t cached = std::min<size_t>(tiles_cached, tile_limit);
+        if (cached <= TILE_CACHE_TILES / 8) return false;
+        tile_limit = std::max<size_t>(cached / 2, TILE_CACHE_TILES / 8);
+        wake();
+        return true;
+    }
+
+    Stats stats() const {
+        return {frames, menu_redraws, superseded, last_cost_us, latency_sum_us, latency_count, latency_max_us,
+                tile_hits, tile_loads, tile_renders, tile_live_renders, tile_holes, tiles_cached,
+                repairs, repaired_pixels};
+    }
+};
+
+struct Config {
+    speed_t baud_rate = B9600;
+    int save_interval = 30;
+    char csv_delimiter = ',';
+    float temp_range[2] = {-40.0f, 85.0f};
+    float press_range[2] = {300.0f, 1100.0f};
+    std::string menu_bg_color = "#808080";
+    std::string help_bg_color = "#D3D3D3";
+    std::array<std::string, 4> graph_colors = {"blue", "red", "green", "yellow"};
+    int motif_window = MP_DEFAULT_WINDOW;
+    int motif_top_k = MP_DEFAULT_TOP_K;
+    IntegralMethod tw_method = IntegralMethod::Step;
+    bool time_weighted = false;
+    float heating_base = 18.0f;
+    float cooling_base = 18.0f;
+    std::vector<AccumulatorDef> exceedances;
+    std::string capture_file;
+    int checkpoint_interval = 60;
+    std::string sinks = "csv,stdout";
+    int reorder_window = 0;
+    int memory_budget_mb = MEMORY_DEFAULT_BUDGET_MB;
+    FlowControl flow_control = FlowControl::Off;
+    double decimate_above_hz = 0.0;
+};
+
+class BMP280Gui {
+private:
+    enum class Theme { White, Dark, HighContrast };
+
+    std::unique_ptr<X11Display> x11;
+    Display* dpy;
+    Window win;
+    std::unique_ptr<FrameRenderer> renderer;
+    std::unique_ptr<SerialPort> serial;
+    int fd;
+    CircularBuffer history;
+    SlidingWindowStats window_stats{STATS_WINDOW, IntegralMethod::Step};
+    RollupStore rollups{IntegralMethod::Step};
+    RangeIndex range_index;
+    AccumulatorStore accumulators{IntegralMethod::Step};
+    Metrics metrics;
+    std::string filename;
+    time_t last_save;
+    std::array<unsigned long, 4> colors;
+    unsigned long background_color;
+    unsigned long text_color;
+    unsigned long menu_bg_color;
+    unsigned long menu_text_color;
+    unsigned long menu_highlight_color;
+    unsigned long help_bg_color;
+    unsigned long keybind_color;
+    Theme theme = Theme::White;
+    float zoom_temp = 1.0f, zoom_press = 1.0f;
+    float vzoom_temp = 1.0f, vzoom_press = 1.0f;
+    int offset_temp = 0, offset_press = 0;
+    mutable std::vector<std::string> error_messages;
+    mutable std::vector<std::string> persistent_errors;
+    mutable time_t last_error_time = 0;
+    time_t last_reconnect_attempt = 0;
+    int reconnect_attempts = 0;
+    time_t menu_highlight_time = 0;
+    float temp_range[2] = {-40.0f, 85.0f};
+    float press_range[2] = {300.0f, 1100.0f};
+    float default_temp_range[2] = {-40.0f, 85.0f};
+    float default_press_range[2] = {300.0f, 1100.0f};
+    speed_t baud_rate = B9600;
+    FlowControl flow_control = FlowControl::Off;
+    int save_interval = 30;
+    char csv_delimiter = ',';
+    int motif_window = MP_DEFAULT_WINDOW;
+    int motif_top_k = MP_DEFAULT_TOP_K;
+    std::vector<Annotation> annotations;
+    std::future<std::vector<Annotation>> analysis_job;
+    IntegralMethod tw_method = IntegralMethod::Step;
+    std::array<bool, 2> time_weighted = {false, false};
+    int pointer_y = -1;
+    bool selecting = false;
+    bool has_selection = false;
+    bool selection_is_temp = true;
+    time_t selection_from = 0, selection_to = 0;
+    bool paused = false;
+    bool window_mapped = false;
+    bool window_visible = true;
+    bool frame_valid = false;
+    double last_cpu_seconds = 0.0;
+    uint64_t last_cpu_sample_us = 0;
+    bool show_help = false;
+    int selected_help_item = -1;
+    bool dragging = false;
+    int drag_start_x = 0;
+    int pan_remainder = 0;
+    std::optional<XMotionEvent> pending_motion;
+    uint64_t input_time_us = 0;
+    bool needs_redraw = false;
+    LoadShedder shedder;
+    bool frame_deferred = false;
+    uint64_t frames_seen = 0;
+    bool motif_deferred = false;
+    DependencyGraph graph;
+    FrameState frame_cache;
+    struct ViewWindow {
+        int start = 0, max_points = 0;
+        time_t from = 0;
+        int level = 0;
+        uint64_t pass = 0;
+    };
+    std::array<ViewWindow, 2> windows;
+    int frame_node = -1, menu_node = -1;
+    uint64_t drawn_frame = 0, drawn_menu = 0;
+    uint64_t data_version = 0;
+    uint64_t annotations_version = 0;
+    bool overview = false;
+    int overview_level = 8;
+    int overview_pan = 0;
+    std::set<uint64_t> tiles_on_disk;
+    std::map<std::pair<int, int64_t>, uint32_t> tile_revisions;
+    std::set<std::pair<int, int64_t>> stale_tiles;
+    struct TileFill {
+        uint32_t revision = 0;
+        time_t newest = 0;
+        bool complete = false;
+        uint64_t used = 0;
+        std::array<std::vector<Aggregate>, 2> columns;
+    };
+    using TileFills = std::vector<std::pair<std::pair<int, int64_t>, TileFill>>;
+    std::map<std::pair<int, int64_t>, TileFill> tile_fills;
+    std::set<std::pair<int, int64_t>> tile_requests;
+    std::future<TileFills> tile_job;
+    bool tile_backlog = false;
+    uint64_t tile_pass = 0;
+    uint64_t tile_holes_seen = 0;
+    time_t last_tile_prune = 0;
+    SampleParser parser{[this](float temp, float press) {
+                            serial_batch.points.push_back({temp, press, chunk_time});
+                        },
+                        [this](const std::string& msg) { parse_error(msg); }};
+    time_t chunk_time = 0;
+    int checkpoint_interval = 60;
+    UartCounters uart;
+    UartCounters uart_totals;
+    int uart_queue_max = 0;
+    uint64_t last_read_cycle_us = 0;
+    uint64_t serial_wait_us = 0;
+    time_t last_uart_error = 0;
+    time_t last_checkpoint = 0;
+    std::future<bool> checkpoint_job;
+    std::string capture_file;
+    std::string sink_spec = "csv,stdout";
+    ReorderBuffer reorder{0};
+    std::string archive_path;
+    Decimator decimator{0.0};
+    std::map<time_t, Envelope> envelopes;
+    struct RawView {
+        time_t from = 0, to = 0;
+        std::shared_ptr<const std::vector<DataPoint>> points;
+    };
+    std::array<RawView, 2> raw_views;
+    BlockCache block_cache{ARCHIVE_CACHE_BLOCKS};
+    std::array<std::future<RawView>, 2> raw_jobs;
+    MemoryAccountant memory{size_t(MEMORY_DEFAULT_BUDGET_MB) << 20};
+    time_t last_memory_check = 0;
+    bool show_hud = false;
+    std::string stream_path;
+    CsvSink* csv_sink = nullptr;
+    BroadcastRing broadcast;
+    std::vector<std::unique_ptr<SinkRunner>> sinks;
+    std::vector<DataPoint> pending_batch;
+    std::unique_ptr<CaptureWriter> capture;
+    double replay_speed = 1.0;
+    bool replaying = false;
+    std::thread replay_thread;
+    std::atomic<bool> replay_stop{false}, replay_paused{false};
+    // Every sensor reader hands its parsed samples to the ingest stage (reorder, history, statistics,
+    // sinks) as batches through this queue; the main loop is its single consumer.
+    struct IngestBatch {
+        std::vector<DataPoint> points;
+        std::vector<std::string> errors;
+        bool finished = false;
+    };
+    MpscQueue<IngestBatch> ingest_queue{INGEST_QUEUE_BATCHES};
+    IngestBatch serial_batch;
+    XFontStruct* regular_font = nullptr;
+    XFontStruct* bold_font = nullptr;
+
+    static constexpr int max_reconnect_attempts = 10;
+
+    static int x11_error_handler(Display* dpy, XErrorEvent* err) {
+        char err_msg[256];
+        XGetErrorText(dpy, err->error_code, err_msg, sizeof(err_msg));
+        std::ofstream log("logs/errors.log", std::ios::app);
+        if (log) {
+            time_t now = time(nullptr);
+            log << std::ctime(&now) << ": X11 error: " << err_msg << "\n";
+        }
+        std::cerr << "X11 error: " << err_msg << "\n";
+        if (err->error_code == BadWindow || err->error_code == BadDrawable) {
+            throw std::runtime_error("Critical X11 error: " + std::string(err_msg));
+        }
+        return 0;
+    }
+
+    void add_error(const std::string& msg, bool persistent = false) const {
+        if (error_messages.size() >= 5) error_messages.erase(error_messages.begin());
+        error_messages.push_back(msg);
+        if (persistent) {
+            if (persistent_errors.size() >= 5) persistent_errors.erase(persistent_errors.begin());
+            persistent_errors.push_back(msg);
+        }
+        last_error_time = time(nullptr);
+        std::ofstream log("logs/errors.log", std::ios::app);
+        if (log) log << std::ctime(&last_error_time) << ": " << msg << "\n";
+    }
+
+    std::optional<std::string> find_serial_port() const {
+        static const char* prefixes[] = {"/dev/ttyACM", "/dev/ttyUSB"};
+        for (const auto* prefix : prefixes) {
+            for (int i = 0; i < 10; ++i) {
+                std::string port = std::string(prefix) + std::to_string(i);
+                if (std::filesystem::exists(port)) return port;
+            }
+        }
+        return std::nullopt;
+    }
+
+    bool open_serial(const std::string& port, speed_t baud) {
+        try {
+            serial = std::make_unique<SerialPort>(port, baud, flow_control);
+            fd = serial->get();
+            uart = serial->counters();
+            uart_totals = UartCounters{};
+            uart_totals.has_icount = uart.has_icount;
+            return true;
+        } catch (const std::exception& e) {
+            add_error(e.what(), true);
+            fd = -1;
+            return false;
+        }
+    }
 
-        set_foreground(help_bg_color);
-        XFillRectangle(dpy, pixmap, gc, start_x, start_y, rect_width, rect_height);
+    void try_reconnect() {
+        if (fd != -1 || replaying || reconnect_attempts >= max_reconnect_attempts) return;
+        if (difftime(time(nullptr), last_reconnect_attempt) < RECONNECT_TIMEOUT) return;
+        last_reconnect_attempt = time(nullptr);
+        reconnect_attempts++;
 
-        set_foreground(text_color);
-        XDrawRectangle(dpy, pixmap, gc, start_x, start_y, rect_width - 1, rect_height - 1);
+        auto port = find_serial_port();
+        if (!port) {
+            add_error("No serial port available", true);
+            return;
+        }
 
-        int y = start_y + padding + line_height - 5;
-        for (size_t i = 0; i < help_lines.size(); ++i) {
-            const auto& line = help_lines[i];
-            int text_width = XTextWidth(i == 0 ? bold_font : regular_font, line.data(), line.length());
-            int text_x = start_x + (rect_width - text_width) / 2;
+        speed_t baud_rates[] = {B9600, B115200};
+        for (speed_t baud : baud_rates) {
+            if (open_serial(*port, baud)) {
+                baud_rate = baud;
+                std::cout << "Reconnected to " << *port << " at baud rate " << (baud == B9600 ? 9600 : 115200) << "\n";
+                persistent_errors.clear();
+                error_messages.clear();
+                reconnect_attempts = 0;
+                return;
+            }
+        }
+        add_error("Failed to reconnect to " + *port + " with any baud rate", true);
+    }
 
-            if (static_cast<int>(i) == selected_help_item) {
-                set_foreground(menu_highlight_color);
-                XFillRectangle(dpy, pixmap, gc, start_x + padding, y - line_height + 5, rect_width - 2 * padding, line_height);
+    void poll_uart() {
+        UartCounters now = serial->counters();
+        int errors = 0;
+        if (now.has_icount && uart.has_icount) {
+            auto account = [&](int UartCounters::*field, const char* series, bool is_error) {
+                int delta = now.*field - uart.*field;
+                if (delta <= 0) return;
+                uart_totals.*field += delta;
+                metrics.add(series, delta);
+                if (is_error) errors += delta;
+            };
+            account(&UartCounters::rx, "bmp280_uart_rx_bytes_total", false);
+            account(&UartCounters::overrun, "bmp280_uart_overruns_total", true);
+            account(&UartCounters::buf_overrun, "bmp280_uart_buffer_overruns_total", true);
+            account(&UartCounters::frame, "bmp280_uart_frame_errors_total", true);
+            account(&UartCounters::parity, "bmp280_uart_parity_errors_total", true);
+            account(&UartCounters::brk, "bmp280_uart_breaks_total", false);
+        }
+        uart_totals.queued = now.queued;
+        uart_queue_max = std::max(uart_queue_max, now.queued);
+        metrics.set("bmp280_uart_input_queue_bytes", now.queued);
+        metrics.set("bmp280_uart_input_queue_max_bytes", uart_queue_max);
+        if (errors > 0) last_uart_error = time(nullptr);
+        uart = now;
+    }
+
+    void parse_error(const std::string& msg) {
+        bool after_uart_error = last_uart_error != 0 && difftime(time(nullptr), last_uart_error) <= UART_ERROR_WINDOW;
+        metrics.add(after_uart_error ? "bmp280_parse_errors_total{cause=\"uart\"}" : "bmp280_parse_errors_total{cause=\"data\"}", 1);
+        add_error(after_uart_error ? msg + " (UART errors, host falling behind?)" : msg);
+    }
+
+    void read_serial() {
+        if (fd == -1 || paused) {
+            last_read_cycle_us = 0;
+            return;
+        }
+        poll_uart();
+
+        // A stall is a gap between read cycles, not between samples: the device may be slow or idle.
+        uint64_t cycle_us = now_us();
+        if (last_read_cycle_us != 0 && cycle_us - last_read_cycle_us > SERIAL_STALL_US) {
+            metrics.add("bmp280_serial_stalls_total", 1);
+            metrics.add("bmp280_serial_stall_absorbed_bytes_total", uart_totals.queued);
+            metrics.set("bmp280_serial_stall_absorbed_bytes_max",
+                        std::max<double>(uart_totals.queued, metrics.get("bmp280_serial_stall_absorbed_bytes_max")));
+        }
+        last_read_cycle_us = cycle_us;
+
+        fd_set set;
+        struct timeval timeout = {0, 100000};
+        FD_ZERO(&set);
+        FD_SET(fd, &set);
+
+        uint64_t wait_start = now_us();
+        int ready = select(fd + 1, &set, nullptr, nullptr, &timeout);
+        serial_wait_us += now_us() - wait_start;
+        if (ready < 0) {
+            add_error("Select error: " + std::string(strerror(errno)));
+            serial->close_port();
+            fd = -1;
+            return;
+        }
+        if (ready == 0) return;
+
+        for (int i = 0; i < SERIAL_MAX_READS; ++i) {
+            if (parser.free_space() == 0) parser.reset();
+            int len = read(fd, parser.write_ptr(), parser.free_space());
+            if (len < 0 && errno != EAGAIN) {
+                add_error("Serial read error: " + std::string(strerror(errno)));
+                serial->close_port();
+                fd = -1;
+                return;
+            }
+            if (len <= 0) return;
+
+            uint64_t read_us = wall_us();
+            if (capture) capture->append(read_us, parser.write_ptr(), len);
+            chunk_time = static_cast<time_t>(read_us / 1000000u);
+            parser.commit(len);
+        }
+    }
+
+    // The main thread is the queue's consumer, so a full queue is drained in place.
+    void submit_serial() {
+        if (serial_batch.points.empty()) return;
+        while (!ingest_queue.try_push(&serial_batch, 1)) drain_ingest();
+        serial_batch = {};
+    }
+
+    void drain_ingest() {
+        ingest_queue.pop([this](IngestBatch&& batch) {
+            for (const auto& p : batch.points) accept(p);
+            for (const auto& msg : batch.errors) parse_error(msg);
+            if (batch.finished) {
+                replaying = false;
+                add_error("Replay finished", true);
+            }
+        });
+    }
+
+    // A replay is a sensor reader on its own thread: it paces and parses the capture and submits each
+    // chunk's samples to ingest_queue. Time spent paused does not count towards the pacing.
+    void run_replay(std::unique_ptr<CaptureReader> reader) {
+        IngestBatch batch;
+        time_t time = 0;
+        SampleParser replay_parser([&](float temp, float press) { batch.points.push_back({temp, press, time}); },
+                                   [&](const std::string& msg) { batch.errors.push_back(msg); });
+        auto submit = [&] {
+            while (!ingest_queue.try_push(&batch, 1)) {
+                if (replay_stop) return false;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            batch = {};
+            return true;
+        };
+        uint64_t start_us = now_us(), origin_us = 0, chunk_us;
+        std::string chunk;
+        while (!replay_stop && reader->next(chunk_us, chunk)) {
+            if (origin_us == 0) origin_us = chunk_us;
+            while (!replay_stop) {
+                if (replay_paused) {
+                    uint64_t paused_at = now_us();
+                    while (replay_paused && !replay_stop) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                    start_us += now_us() - paused_at;
+                }
+                if (replay_speed <= 0.0) break;
+                double ahead = (chunk_us - origin_us) / replay_speed - static_cast<double>(now_us() - start_us);
+                if (ahead <= 0.0) break;
+                std::this_thread::sleep_for(std::chrono::microseconds(static_cast<int64_t>(std::min(ahead, 50000.0))));
+            }
+            time = static_cast<time_t>(chunk_us / 1000000u);
+            replay_parser.feed(chunk.data(), chunk.size());
+            if ((!batch.points.empty() || !batch.errors.empty()) && !submit()) return;
+        }
+        batch.finished = true;
+        submit();
+    }
+
+    void push_history(const DataPoint& point, const Envelope& envelope) {
+        history.push(point);
+        ++data_version;
+        if (envelope.count > 1) envelopes[point.timestamp] = envelope;
+        time_t oldest = history[0].timestamp;
+        while (!envelopes.empty() && envelopes.begin()->first < oldest) envelopes.erase(envelopes.begin());
+    }
+
+    void ingest(const DataPoint& point, bool replayed = false) {
+        if (decimator.enabled() && !replayed)
+            decimator.add(point, [this](const DataPoint& p, const Envelope& e) { push_history(p, e); });
+        else
+            history.push(point);
+        ++data_version;
+        window_stats.push(point.timestamp, point.temperature, point.pressure);
+        rollups.add(point);
+        range_index.push(point);
+        if (!replayed) {
+            accumulators.add(point);
+            metrics.add("bmp280_samples_total", 1);
+            pending_batch.push_back(point);
+        }
+    }
+
+    void accept(const DataPoint& point) {
+        if (point.timestamp < reorder.newest_timestamp()) metrics.add("bmp280_reorder_out_of_order_total", 1);
+        if (!reorder.push(point)) {
+            ingest_late(point);
+            return;
+        }
+        reorder.drain(time(nullptr), [this](const DataPoint& p) { ingest(p); });
+    }
+
+    void ingest_late(const DataPoint& point) {
+        // While decimating, the history holds per-second means that already cover this second.
+        bool kept = decimator.active() || history.insert(point);
+        if (!kept || !patch_late(range_index, rollups, accumulators, point)) {
+            metrics.add("bmp280_reorder_dropped_total", 1);
+            add_error("Dropped late sample from " + format_time(point.timestamp));
+            return;
+        }
+        ++data_version;
+        invalidate_tiles(point.timestamp);
+        window_stats.insert(point.timestamp, point.temperature, point.pressure);
+        metrics.add("bmp280_samples_total", 1);
+        metrics.add("bmp280_reorder_late_total", 1);
+        pending_batch.push_back(point);
+    }
+
+    void track_memory() {
+        memory.track("history", [this] { return sizeof(history) + 2 * MAX_POINTS * sizeof(float); });
+        memory.track("window_stats", [this] { return window_stats.memory_usage(); });
+        memory.track("reorder", [this] { return reorder.memory_usage(); });
+        memory.track("sink_ring", [this] { return broadcast.memory_usage(); });
+        memory.track("annotations", [this] { return annotations.capacity() * sizeof(Annotation); });
+        memory.track("envelopes", [this] { return envelopes.size() * (sizeof(Envelope) + sizeof(time_t) + 4 * sizeof(void*)); });
+        memory.track("raw_views", [this] {
+            size_t points = 0;
+            for (const auto& view : raw_views)
+                if (view.points) points += view.points->capacity();
+            return points * sizeof(DataPoint);
+        });
+        memory.track("block_cache", [this] { return block_cache.memory_usage(); }, [this] { return block_cache.shrink(); }, -1);
+        memory.track("tiles", [this] { return renderer->tile_memory(); }, [this] { return renderer->shrink_tiles(); }, -1);
+        memory.track("tile_fills", [this] { return tile_fills.size() * (sizeof(TileFill) + 2 * TILE_WIDTH * sizeof(Aggregate)); });
+        memory.track("range_index", [this] { return range_index.memory_usage(); },
+                     [this] { return range_index.trim(range_index.get_size() / 2); }, 0);
+        memory.track("rollups", [this] { return rollups.memory_usage(); }, [this] { return rollups.trim(); }, 1);
+        memory.track("accumulators", [this] { return accumulators.memory_usage(); }, [this] { return accumulators.trim(); }, 2);
+    }
+
+    void start_sinks() {
+        std::filesystem::create_directory("logs");
+        std::string stem = "logs/" + std::filesystem::path(filename).stem().string();
+        std::istringstream spec(sink_spec);
+        std::string name;
+        while (std::getline(spec, name, ',')) {
+            if (name.empty()) continue;
+            try {
+                std::unique_ptr<OutputSink> sink;
+                if (name == "csv") {
+                    stream_path = "logs/" + filename;
+                    auto csv = std::make_unique<CsvSink>(stream_path, csv_delimiter);
+                    csv_sink = csv.get();
+                    sink = std::move(csv);
+                } else if (name == "archive") {
+                    archive_path = stem + ".bin";
+                    sink = std::make_unique<ArchiveSink>(archive_path);
+                } else if (name == "stdout") {
+                    sink = std::make_unique<StdoutSink>();
+                } else if (name.find("udp:") == 0) {
+                    sink = std::make_unique<UdpSink>(name.substr(4));
+                } else if (name == "metrics") {
+                    sink = std::make_unique<MetricsSink>(metrics);
+                } else {
+                    add_error("Unknown sink: " + name);
+                    continue;
+                }
+                sinks.push_back(std::make_unique<SinkRunner>(name, std::move(sink), broadcast));
+            } catch (const std::exception& e) {
+                add_error(e.what(), true);
+            }
+        }
+    }
+
+    void publish_batch() {
+        if (pending_batch.empty()) return;
+        broadcast.publish(std::move(pending_batch));
+        pending_batch.clear();
+    }
+
+    static constexpr char checkpoint_magic[8] = {'B', 'M', 'P', 'C', 'K', 'P', 'T', '\n'};
+
+    std::string build_checkpoint() const {
+        BinaryWriter out;
+        for (char c : checkpoint_magic) out.put(c);
+        out.put<uint32_t>(CHECKPOINT_VERSION);
+        out.put<int64_t>(time(nullptr));
+        window_stats.save(out);
+        rollups.save(out);
+        accumulators.save(out);
+        std::string data = out.str();
+        uint64_t checksum = fnv1a(data.data(), data.size());
+        data.append(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+        return data;
+    }
+
+    void write_checkpoint() {
+        if (checkpoint_job.valid()) {
+            if (checkpoint_job.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return;
+            if (!checkpoint_job.get()) add_error("Failed to write checkpoint " CHECKPOINT_PATH);
+        }
+        std::filesystem::create_directory("logs");
+        checkpoint_job = std::async(std::launch::async, [data = build_checkpoint()]() {
+            return write_file_atomic(CHECKPOINT_PATH, data);
+        });
+        last_checkpoint = time(nullptr);
+    }
+
+    void restore_checkpoint() {
+        std::ifstream in(CHECKPOINT_PATH, std::ios::binary);
+        if (!in) return;
+        std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        const size_t header = sizeof(checkpoint_magic) + sizeof(uint32_t) + sizeof(int64_t);
+        uint64_t checksum = 0;
+        if (data.size() >= header + sizeof(checksum))
+            std::memcpy(&checksum, data.data() + data.size() - sizeof(checksum), sizeof(checksum));
+        if (data.size() < header + sizeof(checksum) ||
+            std::memcmp(data.data(), checkpoint_magic, sizeof(checkpoint_magic)) != 0 ||
+            fnv1a(data.data(), data.size() - sizeof(checksum)) != checksum) {
+            add_error("Ignoring corrupt checkpoint " CHECKPOINT_PATH);
+            return;
+        }
+        data.resize(data.size() - sizeof(checksum));
+        BinaryReader reader(data, sizeof(checkpoint_magic));
+        uint32_t version = reader.get<uint32_t>();
+        time_t written_at = static_cast<time_t>(reader.get<int64_t>());
+        if (version != CHECKPOINT_VERSION) {
+            add_error("Ignoring checkpoint version " + std::to_string(version));
+            return;
+        }
+
+        bool ok = window_stats.restore(reader) && rollups.restore(reader) && accumulators.restore(reader);
+        if (!ok) add_error("Checkpoint " CHECKPOINT_PATH " is incomplete, rebuilding from history");
+        for (size_t i = 0; i < history.get_size(); ++i) {
+            const auto& p = history[i];
+            if (p.timestamp > window_stats.last_timestamp()) window_stats.push(p.timestamp, p.temperature, p.pressure);
+            if (p.timestamp > rollups.last_timestamp()) rollups.add(p);
+            if (p.timestamp > accumulators.last_timestamp()) accumulators.add(p);
+        }
+        if (ok) add_error("Restored analytics checkpoint from " + format_time(written_at));
+    }
+
+    void persist_analytics() {
+        std::filesystem::create_directory("logs");
+        if (!accumulators.save("logs/accumulators.csv")) add_error("Failed to save accumulators");
+
+        time_t now = time(nullptr);
+        const auto& defs = accumulators.definitions();
+        for (RollupLevel level : {RollupLevel::Day, RollupLevel::Month}) {
+            auto totals = accumulators.totals(level, now);
+            for (size_t k = 0; k < defs.size(); ++k) {
+                metrics.set("bmp280_accumulator{name=\"" + defs[k].name + "\",period=\"" +
+                            rollup_level_name(level) + "\"}", totals[k]);
+            }
+        }
+        metrics.set("bmp280_history_points", static_cast<double>(history.get_size()));
+        metrics.set("bmp280_serial_connected", fd != -1 ? 1.0 : 0.0);
+        metrics.set("bmp280_reorder_held", static_cast<double>(reorder.get_held()));
+        metrics.set("bmp280_input_rate_hz", decimator.rate());
+        metrics.set("bmp280_decimation_active", decimator.active() ? 1.0 : 0.0);
+        metrics.set("bmp280_memory_budget_bytes", static_cast<double>(memory.get_budget()));
+        metrics.set("bmp280_memory_tracked_bytes", static_cast<double>(memory.total()));
+        metrics.set("bmp280_process_rss_bytes", static_cast<double>(process_rss_bytes()));
+        memory.for_each([this](const std::string& name, size_t bytes, uint64_t evictions) {
+            std::string label = "{subsystem=\"" + name + "\"}";
+            metrics.set("bmp280_memory_bytes" + label, static_cast<double>(bytes));
+            metrics.set("bmp280_memory_evictions_total" + label, static_cast<double>(evictions));
+        });
+        metrics.set("bmp280_block_cache_hits_total", static_cast<double>(block_cache.get_hits()));
+        metrics.set("bmp280_block_cache_misses_total", static_cast<double>(block_cache.get_misses()));
+        metrics.set("bmp280_block_cache_evictions_total", static_cast<double>(block_cache.get_evictions()));
+        metrics.set("bmp280_block_cache_blocks", static_cast<double>(block_cache.get_blocks()));
+        metrics.set("bmp280_block_cache_retired_pending", static_cast<double>(block_cache.domain().get_pending()));
+        metrics.set("bmp280_block_cache_reclaimed_total", static_cast<double>(block_cache.domain().get_freed()));
+        for (const auto& runner : sinks) {
+            std::string label = "{sink=\"" + runner->get_name() + "\"}";
+            metrics.set("bmp280_sink_lag_batches" + label, static_cast<double>(runner->get_lag()));
+            metrics.set("bmp280_sink_delivered_samples_total" + label, static_cast<double>(runner->get_delivered()));
+            metrics.set("bmp280_sink_dropped_samples_total" + label, static_cast<double>(runner->get_dropped()));
+            metrics.set("bmp280_sink_errors_total" + label, static_cast<double>(runner->get_errors()));
+        }
+        if (!metrics.write("logs/metrics.prom")) add_error("Failed to write metrics");
+    }
+
+    float compute_visible_average(bool is_temp, int start, int max_points) const {
+        if (history.get_size() == 0) return 0.0f;
+        Aggregate agg;
+        for (int i = start; i < start + max_points && static_cast<size_t>(i) < history.get_size(); ++i) {
+            const auto& point = history[i];
+            float v = is_temp ? point.temperature : point.pressure;
+            if (i > start) {
+                const auto& prev = history[i - 1];
+                double seconds = difftime(point.timestamp, prev.timestamp);
+                agg.add_segment(segment_integral(is_temp ? prev.temperature : prev.pressure, v, seconds, tw_method), seconds);
+            }
+            agg.add_sample(v);
+        }
+        return time_weighted[is_temp ? 0 : 1] ? agg.time_weighted_mean() : agg.mean();
+    }
+
+    void visible_window(bool is_temp, int& start, int& max_points) const {
+        float zoom = std::clamp(is_temp ? zoom_temp : zoom_press, 1.0f, 100.0f);
+        int offset = std::clamp(is_temp ? offset_temp : offset_press, 0, static_cast<int>(history.get_size()));
+        max_points = static_cast<int>(MAX_POINTS / zoom);
+        start = std::max(0, std::min(static_cast<int>(history.get_size()) - 2, static_cast<int>(history.get_size()) - max_points - offset));
+    }
+
+    time_t timestamp_at(bool is_temp, int px) const {
+        int start, max_points;
+        visible_window(is_temp, start, max_points);
+        int last = std::min(start + max_points, static_cast<int>(history.get_size())) - 1;
+        int i = std::clamp(start + (px - 100) * max_points / 600, start, std::max(start, last));
+        return history[i].timestamp;
+    }
+
+    bool update_window(int ch) {
+        ViewWindow v;
+        if (overview) {
+            time_t spp = time_t(1) << overview_level;
+            time_t newest = std::max(rollups.last_timestamp(), history.get_size() ? history[history.get_size() - 1].timestamp : 0);
+            v.from = (newest / spp + 1 - overview_pan - 600) * spp;
+            v.level = overview_level;
+            v.pass = tile_pass;
+        } else {
+            visible_window(ch == 0, v.start, v.max_points);
+        }
+        bool changed = v.start != windows[ch].start || v.max_points != windows[ch].max_points || v.from != windows[ch].from ||
+                       v.level != windows[ch].level || v.pass != windows[ch].pass;
+        windows[ch] = v;
+        return changed;
+    }
+
+    // Per-pixel aggregates for one overview tile: hourly (or daily) rollups at coarse levels, the in-memory
+    // history below that (archive-backed tiles come from the tile job). `complete` is false when the
+    // source no longer covers the tile.
+    std::vector<Aggregate> tile_columns(int ch, time_t t0, time_t spp, bool& complete) {
+        std::vector<Aggregate> columns(TILE_WIDTH);
+        time_t t1 = t0 + spp * TILE_WIDTH;
+        if (spp >= 3600) {
+            auto merge = [&](const RollupBucket& b) {
+                for (time_t t = std::max(b.start, t0); t < std::min(b.end, t1); t += spp - (t - t0) % spp)
+                    columns[(t - t0) / spp].merge(b.channels[ch]);
+            };
+            complete = rollups.for_range(RollupLevel::Hour, t0, t1, merge);
+            if (!complete) {
+                columns.assign(TILE_WIDTH, Aggregate{});
+                complete = rollups.for_range(RollupLevel::Day, t0, t1, merge);
+            }
+        } else {
+            complete = history.get_size() > 0 && history[0].timestamp <= t0;
+            for (size_t i = history.lower_index(t0); i < history.get_size() && history[i].timestamp < t1; ++i)
+                columns[(history[i].timestamp - t0) / spp].add_sample(ch == 0 ? history[i].temperature : history[i].pressure);
+        }
+        return columns;
+    }
+
+    // Sealed tiles the renderer already stored are sent by key only; it composites them from its cache.
+    // Tiles at the live edge are always drawn fresh, missing sealed ones a few per frame. Archive-backed
+    // tiles use the latest fill from the tile job and queue a new one when it is out of date.
+    bool update_overview(int ch) {
+        auto& s = frame_cache.graphs[ch];
+        time_t spp = time_t(1) << windows[ch].level, span = spp * TILE_WIDTH;
+        s.overview = true;
+        s.tiles.clear();
+        s.max_points = 600;
+        s.start_time = windows[ch].from;
+        s.end_time = windows[ch].from + 600 * spp;
+        uint64_t sensor = archive_path.empty() ? 0 : fnv1a(archive_path.data(), archive_path.size());
+        uint64_t palette = hash_state(background_color, frame_cache.envelope, s.color_low);
+        time_t newest = rollups.last_timestamp();
+        int fills = 0;
+        for (int64_t index = s.start_time / span; index * span < s.end_time; ++index) {
+            time_t t0 = index * span;
+            FrameState::Tile tile;
+            tile.level = windows[ch].level;
+            tile.index = index;
+            tile.x = static_cast<int>((t0 - s.start_time) / spp);
+            auto rev = tile_revisions.find({tile.level, index});
+            tile.key = hash_state(sensor, ch, tile.level, index, palette, s.min_val, s.max_val,
+                                  rev == tile_revisions.end() ? 0u : rev->second);
+            bool sealed = t0 + span + tile_slack(spp) <= newest;
+            if (sealed && tiles_on_disk.count(tile.key)) {
+                s.tiles.push_back(std::move(tile));
+                continue;
+            }
+            bool complete = false;
+            if (spp < 3600 && !archive_path.empty()) {
+                uint32_t revision = rev == tile_revisions.end() ? 0u : rev->second;
+                auto fill = tile_fills.find({tile.level, index});
+                if (fill != tile_fills.end() && fill->second.revision != revision) fill = tile_fills.end();
+                bool current = fill != tile_fills.end() &&
+                               (fill->second.complete || fill->second.newest >= std::min(newest, t0 + span + tile_slack(spp)));
+                if (!current) tile_requests.insert({tile.level, index});
+                if (fill == tile_fills.end()) continue;
+                fill->second.used = tile_pass;
+                tile.columns = fill->second.columns[ch];
+                complete = current && fill->second.complete;
+            } else {
+                if (sealed && fills++ >= TILE_FILLS_PER_FRAME) {
+                    tile_backlog = true;
+                    continue;
+                }
+                tile.columns = tile_columns(ch, t0, spp, complete);
+            }
+            if (std::none_of(tile.columns.begin(), tile.columns.end(), [](const Aggregate& a) { return a.count > 0; })) continue;
+            tile.cacheable = sealed && complete;
+            s.tiles.push_back(std::move(tile));
+        }
+        return true;
+    }
+
+    // Fills queued archive-backed tiles off the event thread, a few per job with the newest first, reading
+    // each tile's range once for both channels.
+    void request_tile_fills() {
+        if (tile_requests.empty() || tile_job.valid()) return;
+        TileFills jobs;
+        time_t newest = rollups.last_timestamp();
+        while (!tile_requests.empty() && jobs.size() < TILE_FILLS_PER_FRAME) {
+            auto tile = *tile_requests.rbegin();
+            tile_requests.erase(tile);
+            auto rev = tile_revisions.find(tile);
+            TileFill fill;
+            fill.revision = rev == tile_revisions.end() ? 0u : rev->second;
+            fill.newest = newest;
+            jobs.emplace_back(tile, std::move(fill));
+        }
+        tile_job = std::async(std::launch::async, [path = archive_path, jobs = std::move(jobs)]() mutable {
+            for (auto& [tile, fill] : jobs) {
+                time_t spp = time_t(1) << tile.first;
+                fill.complete = archive_tile_columns(path, tile.second * spp * TILE_WIDTH, spp, fill.columns);
+            }
+            return std::move(jobs);
+        });
+    }
+
+    void poll_tile_fills() {
+        if (!tile_job.valid() || tile_job.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return;
+        uint64_t pass = ++tile_pass;
+        for (auto& [tile, fill] : tile_job.get()) {
+            fill.used = pass;
+            tile_fills[tile] = std::move(fill);
+        }
+        if (tile_fills.size() > TILE_CACHE_TILES)
+            for (auto it = tile_fills.begin(); it != tile_fills.end();)
+                it = it->second.used + 1 < pass ? tile_fills.erase(it) : std::next(it);
+        metrics.add("bmp280_tile_fills_total", 1);
+        needs_redraw = true;
+    }
+
+    void invalidate_tiles(time_t t) {
+        for (int level = TILE_MIN_LEVEL; level <= TILE_MAX_LEVEL; ++level) {
+            time_t spp = time_t(1) << level, span = spp * TILE_WIDTH;
+            std::set<int64_t> indices = {t / span, std::max<time_t>(0, t - tile_slack(spp)) / span};
+            for (int64_t index : indices) {
+                ++tile_revisions[{level, index}];
+                stale_tiles.insert({level, index});
+            }
+        }
+        metrics.add("bmp280_tile_invalidations_total", 1);
+    }
+
+    // Removes files of invalidated tiles, and the least recently written ones beyond TILE_DISK_MAX. The
+    // hourly pass (and the first one after startup) also relearns which tile keys are on disk.
+    void maintain_tiles() {
+        std::error_code ec;
+        bool prune = difftime(time(nullptr), last_tile_prune) >= 3600;
+        if (stale_tiles.empty() && !prune) return;
+        std::set<std::string> prefixes;
+        for (const auto& [level, index] : stale_tiles) prefixes.insert(tile_prefix(level, index));
+        stale_tiles.clear();
+        std::vector<std::pair<std::filesystem::file_time_type, std::filesystem::path>> files;
+        for (const auto& entry : std::filesystem::directory_iterator(TILE_DIR, ec)) {
+            std::string name = entry.path().filename().string();
+            size_t end = name.find('_', name.find('_') + 1);
+            if (end != std::string::npos && prefixes.count(name.substr(0, end + 1)))
+                std::filesystem::remove(entry.path(), ec);
+            else if (prune)
+                files.emplace_back(entry.last_write_time(ec), entry.path());
+        }
+        if (!prune) return;
+        last_tile_prune = time(nullptr);
+        std::sort(files.begin(), files.end());
+        size_t excess = files.size() > TILE_DISK_MAX ? files.size() - TILE_DISK_MAX : 0;
+        tiles_on_disk.clear();
+        for (size_t i = 0; i < files.size(); ++i) {
+            if (i < excess) {
+                std::filesystem::remove(files[i].second, ec);
+                continue;
+            }
+            std::string name = files[i].second.filename().string();
+            size_t end = name.find('_', name.find('_') + 1);
+            if (end != std::string::npos) tiles_on_disk.insert(std::strtoull(name.c_str() + end + 1, nullptr, 16));
+        }
+    }
+
+    bool update_series(int ch) {
+        auto& s = frame_cache.graphs[ch];
+        bool is_temp = ch == 0;
+        s.is_temp = is_temp;
+        s.threshold = is_temp ? 18.0f : 0.0f;
+        s.color_low = colors[is_temp ? 1 : 2];
+        s.color_high = colors[is_temp ? 0 : 3];
+        s.values.clear();
+        s.overview = false;
+        s.tiles.clear();
+        if (overview) return update_overview(ch);
+        if (history.get_size() < 2) return true;
+        int start = windows[ch].start;
+        int end = std::min(start + windows[ch].max_points, static_cast<int>(history.get_size()));
+        s.max_points = windows[ch].max_points;
+        for (int i = start; i < end; ++i) s.values.push_back(history.smooth_value(is_temp, i));
+        s.start_time = history[start].timestamp;
+        s.end_time = history[end - 1].timestamp;
+        return true;
+    }
+
+    bool update_yrange(int ch) {
+        auto& s = frame_cache.graphs[ch];
+        if (overview) {
+            Aggregate all;
+            rollups.for_range(RollupLevel::Month, 0, std::numeric_limits<time_t>::max(),
+                              [&](const RollupBucket& b) { all.merge(b.channels[ch]); });
+            const float* default_range = ch == 0 ? default_temp_range : default_press_range;
+            float step = ch == 0 ? 5.0f : 10.0f;
+            float lo = all.count ? std::floor(all.min / step) * step : default_range[0];
+            float hi = all.count ? std::ceil(all.max / step) * step : default_range[1];
+            if (hi <= lo) hi = lo + step;
+            bool changed = lo != s.min_val || hi != s.max_val;
+            s.min_val = lo;
+            s.max_val = hi;
+            return changed;
+        }
+        if (history.get_size() < 2) return false;
+        bool is_temp = ch == 0;
+        float vzoom = std::clamp(is_temp ? vzoom_temp : vzoom_press, 1.0f, 100.0f);
+        const float* default_range = is_temp ? default_temp_range : default_press_range;
+        float default_min = default_range[0];
+        float default_max = default_range[1];
+        float default_span = default_max - default_min;
+
+        float avg_val = compute_visible_average(is_temp, windows[ch].start, windows[ch].max_points);
+        float span = default_span / vzoom;
+        float min_val = avg_val - span / 2.0f;
+        float max_val = avg_val + span / 2.0f;
+        if (min_val < default_min) {
+            min_val = default_min;
+            max_val = min_val + span;
+        }
+        if (max_val > default_max) {
+            max_val = default_max;
+            min_val = max_val - span;
+        }
+        bool changed = min_val != s.min_val || max_val != s.max_val;
+        s.min_val = min_val;
+        s.max_val = max_val;
+        return changed;
+    }
+
+    bool update_labels(int ch) {
+        auto& s = frame_cache.graphs[ch];
+        std::vector<std::string> values, times;
+        char label[32];
+        const char* time_format = s.end_time - s.start_time > 86400 ? "%m-%d %H:%M" : "%H:%M:%S";
+        for (int i = 0; (s.values.size() >= 2 || s.overview) && i <= 5; ++i) {
+            snprintf(label, sizeof(label), "%.0f %s", s.min_val + i * (s.max_val - s.min_val) / 5, s.is_temp ? "C" : "hPa");
+            values.push_back(label);
+            time_t t = s.start_time + (s.end_time - s.start_time) * i / 5;
+            strftime(label, sizeof(label), time_format, localtime(&t));
+            times.push_back(label);
+        }
+        bool changed = values != s.value_labels || times != s.time_labels;
+        s.value_labels.swap(values);
+        s.time_labels.swap(times);
+        return changed;
+    }
+
+    bool update_overlays(int ch) {
+        auto& s = frame_cache.graphs[ch];
+        s.raw.reset();
+        s.envelopes.clear();
+        s.marks.clear();
+        s.selection.reset();
+        if (s.values.size() < 2) return true;
+        bool is_temp = ch == 0;
+        int start = windows[ch].start, max_points = windows[ch].max_points;
+        int end = start + static_cast<int>(s.values.size());
+
+        const RawView& raw = raw_views[ch];
+        if (raw.points && raw.points->size() >= 2 && raw.from == s.start_time && raw.to == s.end_time) s.raw = raw.points;
+        if (!shedder.draw_overlays()) return true;
+        for (int i = start; !s.raw && !envelopes.empty() && i < end; ++i) {
+            auto it = envelopes.find(history[i].timestamp);
+            if (it != envelopes.end()) s.envelopes.emplace_back(i - start, it->second);
+        }
+        time_t oldest = history[0].timestamp;
+        for (const auto& a : annotations) {
+            if (a.is_temp != is_temp || a.end < oldest) continue;
+            int i0 = static_cast<int>(history.lower_index(a.start)) - start;
+            int i1 = static_cast<int>(history.lower_index(a.end)) - start;
+            if (i1 >= 0 && i0 < max_points) s.marks.push_back({i0, i1, a.rank, a.is_motif});
+        }
+        if (has_selection && selection_is_temp == is_temp && std::max(selection_from, selection_to) >= oldest) {
+            int i0 = static_cast<int>(history.lower_index(std::min(selection_from, selection_to))) - start;
+            int i1 = static_cast<int>(history.lower_index(std::max(selection_from, selection_to))) - start;
+            if (i1 >= 0 && i0 < max_points) s.selection = std::make_pair(i0, i1);
+        }
+        return true;
+    }
+
+    template <typename T>
+    static bool assign_changed(T& target, T value) {
+        if (target == value) return false;
+        target = std::move(value);
+        return true;
+    }
+
+    std::vector<std::string> visible_errors() const {
+        std::vector<std::string> errors = persistent_errors;
+        if (difftime(time(nullptr), last_error_time) <= ERROR_DISPLAY_TIME)
+            errors.insert(errors.end(), error_messages.begin(), error_messages.end());
+        return errors;
+    }
+
+    // Inputs are polled once per loop; a frame or menu update only recomputes the nodes downstream of
+    // inputs that actually changed.
+    void build_graph() {
+        auto& g = graph;
+        int data = g.input("data", [this] { return data_version; });
+        int stats = g.input("stats", [this] {
+            Aggregate t = window_stats.get(0), p = window_stats.get(1);
+            return hash_state(t.count, t.sum, t.min, t.max, t.integral, p.count, p.sum, p.min, p.max, p.integral);
+        });
+        int settings = g.input("settings", [this] { return hash_state(time_weighted, tw_method); });
+        int theme_in = g.input("theme", [this] { return hash_state(theme, colors, background_color, text_color, menu_bg_color); });
+        int overlays = g.input("overlays", [this] {
+            return hash_state(shedder.get_level(), annotations_version, raw_views[0].points.get(), raw_views[0].from,
+                              raw_views[0].to, raw_views[1].points.get(), raw_views[1].from, raw_views[1].to);
+        });
+        int selection = g.input("selection", [this] { return hash_state(has_selection, selection_is_temp, selection_from, selection_to); });
+        int hud = g.input("hud", [this] {
+            const UartCounters& u = uart_totals;
+            return hash_state(show_hud, last_memory_check, fd, u.overrun, u.frame, u.parity, u.buf_overrun, u.queued, uart_queue_max);
+        });
+        int status = g.input("status", [this] {
+            return hash_state(std::hash<std::string>{}(filename), save_interval, replaying, fd, paused, shedder.get_level());
+        });
+        int highlight = g.input("highlight", [this] { return hash_state(difftime(time(nullptr), menu_highlight_time) <= HIGHLIGHT_DURATION); });
+        int errors = g.input("errors", [this] {
+            uint64_t h = 0;
+            for (const auto& e : visible_errors()) h = h * 31 + std::hash<std::string>{}(e);
+            return h;
+        });
+        int help = g.input("help", [this] { return hash_state(show_help, selected_help_item); });
+
+        int palette = g.derived("palette", {theme_in, overlays}, [this] {
+            auto& f = frame_cache;
+            f.colors = colors;
+            f.background = background_color;
+            f.text = text_color;
+            f.grid = theme == Theme::White ? 0xCCCCCC : 0x555555;
+            f.envelope = theme == Theme::White ? 0xB0B0B0 : 0x707070;
+            f.menu_bg = menu_bg_color;
+            f.menu_text = menu_text_color;
+            f.menu_highlight = menu_highlight_color;
+            f.help_bg = help_bg_color;
+            f.keybind = keybind_color;
+            f.point_stride = shedder.point_stride();
+            return true;
+        });
+        std::vector<int> frame_deps = {palette};
+        std::array<int, 2> views{}, vzooms{};
+        for (int ch = 0; ch < 2; ++ch) {
+            std::string suffix = ch == 0 ? "_temp" : "_press";
+            views[ch] = g.input("view" + suffix, [this, ch] {
+                return ch == 0 ? hash_state(zoom_temp, offset_temp, overview, overview_level, overview_pan, tile_pass)
+                               : hash_state(zoom_press, offset_press, overview, overview_level, overview_pan, tile_pass);
+            });
+            vzooms[ch] = g.input("vzoom" + suffix, [this, ch] { return hash_state(ch == 0 ? vzoom_temp : vzoom_press); });
+            int window = g.derived("window" + suffix, {views[ch], data}, [this, ch] { return update_window(ch); });
+            int yrange = g.derived("yrange" + suffix, {window, vzooms[ch], data, settings}, [this, ch] { return update_yrange(ch); });
+            int series = g.derived("series" + suffix, {window, yrange, data, palette}, [this, ch] { return update_series(ch); });
+            int labels = g.derived("labels" + suffix, {yrange, series}, [this, ch] { return update_labels(ch); });
+            int marks = g.derived("overlays" + suffix, {series, overlays, selection}, [this, ch] { return update_overlays(ch); });
+            frame_deps.insert(frame_deps.end(), {series, yrange, labels, marks});
+        }
+        frame_deps.push_back(g.derived("footer", {data, stats, settings}, [this] { return assign_changed(frame_cache.footer, format_footer()); }));
+        frame_deps.push_back(g.derived("selection_stats", {selection, data, overlays}, [this] {
+            frame_cache.selection_is_temp = selection_is_temp;
+            return assign_changed(frame_cache.selection_lines, selection_lines());
+        }));
+        frame_deps.push_back(g.derived("hud", {hud, data, overlays}, [this] { return assign_changed(frame_cache.hud_lines, hud_lines()); }));
+        frame_deps.push_back(g.derived("errors", {errors}, [this] { return assign_changed(frame_cache.errors, visible_errors()); }));
+        frame_deps.push_back(g.derived("help", {help}, [this] {
+            frame_cache.show_help = show_help;
+            frame_cache.selected_help_item = selected_help_item;
+            return true;
+        }));
+        menu_node = g.derived("menu", {views[0], vzooms[0], theme_in, status, highlight}, [this] {
+            char text[512];
+            bool changed = assign_changed(frame_cache.menu_status, std::string(text, format_menu_status(text, sizeof(text))));
+            return assign_changed(frame_cache.menu_highlighted, difftime(time(nullptr), menu_highlight_time) <= HIGHLIGHT_DURATION) || changed;
+        });
+        frame_deps.push_back(menu_node);
+        frame_node = g.derived("frame", frame_deps, [] { return true; });
+    }
+
+    std::string format_footer() const {
+        if (history.get_size() == 0) return "";
+        const auto& last = history[history.get_size() - 1];
+        auto stats = calculate_statistics();
+        char info[256];
+        float altitude = 44330.0f * (1.0f - std::pow(last.pressure / 1013.25f, 0.1903f));
+        snprintf(info, sizeof(info),
+                 "Last: T=%.1f C, P=%.1f hPa, A=%.1f m | 5min: T(min/max/%s)=%.1f/%.1f/%.1f C, P(min/max/%s)=%.1f/%.1f/%.1f hPa",
+                 last.temperature, last.pressure, altitude,
+                 time_weighted[0] ? "twa" : "avg", stats.min_temp, stats.max_temp,
+                 time_weighted[0] ? stats.tw_avg_temp : stats.avg_temp,
+                 time_weighted[1] ? "twa" : "avg", stats.min_press, stats.max_press,
+                 time_weighted[1] ? stats.tw_avg_press : stats.avg_press);
+        return info;
+    }
+
+    std::vector<std::string> selection_lines() const {
+        if (!has_selection || !shedder.draw_overlays()) return {};
+        RangeStats r = range_index.query(selection_from, selection_to, selection_is_temp ? 0 : 1);
+        const char* unit = selection_is_temp ? "C" : "hPa";
+        char line[96];
+        std::vector<std::string> lines;
+        int secs = static_cast<int>(r.duration);
+        snprintf(line, sizeof(line), "Selection: %d samples, %dh %02dm %02ds", r.count, secs / 3600, secs / 60 % 60, secs % 60);
+        lines.push_back(line);
+        snprintf(line, sizeof(line), "mean %.2f  min %.2f  max %.2f %s", r.mean, r.min, r.max, unit);
+        lines.push_back(line);
+        snprintf(line, sizeof(line), "stddev %.3f  slope %+.3f %s/h", r.stddev, r.slope_per_hour, unit);
+        lines.push_back(line);
+        return lines;
+    }
+
+    std::vector<std::string> hud_lines() const {
+        if (!show_hud || !shedder.draw_overlays()) return {};
+        std::vector<std::string> lines;
+        char line[96];
+        snprintf(line, sizeof(line), "Memory %.1f / %zu MB, RSS %.1f MB", memory.total() / 1048576.0,
+                 memory.get_budget() >> 20, process_rss_bytes() / 1048576.0);
+        lines.push_back(line);
+        memory.for_each([&](const std::string& name, size_t bytes, uint64_t evictions) {
+            snprintf(line, sizeof(line), "%-13s %9.1f KB  %llu evicted", name.c_str(), bytes / 1024.0,
+                     static_cast<unsigned long long>(evictions));
+            lines.push_back(line);
+        });
+        if (fd != -1) {
+            snprintf(line, sizeof(line), "Serial queue %d B (max %d)", uart_totals.queued, uart_queue_max);
+            lines.push_back(line);
+            if (uart_totals.has_icount)
+                snprintf(line, sizeof(line), "UART overrun %d, buffer %d, frame %d, parity %d", uart_totals.overrun,
+                         uart_totals.buf_overrun, uart_totals.frame, uart_totals.parity);
+            else
+                snprintf(line, sizeof(line), "UART error counters not supported by driver");
+            lines.push_back(line);
+        }
+        return lines;
+    }
+
+    void publish_frame(bool full) {
+        auto frame = std::make_unique<FrameState>(frame_cache);
+        frame->full = full;
+        frame->input_time_us = input_time_us;
+        renderer->publish(std::move(frame));
+        drawn_menu = graph.version(menu_node);
+        if (!full) return;
+        shedder.frame_started(now_us());
+        drawn_frame = graph.version(frame_node);
+        needs_redraw = false;
+        frame_valid = true;
+        int recomputed = 0;
+        graph.take_recomputed([&](const std::string& name, bool ran, uint64_t total) {
+            metrics.set("bmp280_frame_recomputed{node=\"" + name + "\"}", ran ? 1.0 : 0.0);
+            metrics.set("bmp280_recomputes_total{node=\"" + name + "\"}", static_cast<double>(total));
+            recomputed += ran;
+        });
+        metrics.set("bmp280_frame_recomputed_nodes", recomputed);
+    }
+
+    void account_frames() {
+        for (uint64_t key : renderer->take_stored_tiles()) tiles_on_disk.insert(key);
+        auto stats = renderer->stats();
+        if (stats.frames != frames_seen) {
+            frames_seen = stats.frames;
+            shedder.frame_done(stats.last_cost_us);
+        }
+        metrics.set("bmp280_frames_rendered_total", static_cast<double>(stats.frames));
+        metrics.set("bmp280_frames_superseded_total", static_cast<double>(stats.superseded));
+        metrics.set("bmp280_menu_redraws_total", static_cast<double>(stats.menu_redraws));
+        metrics.set("bmp280_input_latency_seconds_sum", stats.latency_sum_us / 1e6);
+        metrics.set("bmp280_input_latency_seconds_count", static_cast<double>(stats.latency_count));
+        metrics.set("bmp280_input_latency_seconds_max", stats.latency_max_us / 1e6);
+        metrics.set("bmp280_tile_hits_total", static_cast<double>(stats.tile_hits));
+        metrics.set("bmp280_tile_disk_loads_total", static_cast<double>(stats.tile_loads));
+        metrics.set("bmp280_tile_renders_total", static_cast<double>(stats.tile_renders));
+        metrics.set("bmp280_tile_live_renders_total", static_cast<double>(stats.tile_live_renders));
+        metrics.set("bmp280_tile_holes_total", static_cast<double>(stats.tile_holes));
+        metrics.set("bmp280_tiles_cached", static_cast<double>(stats.tiles_cached));
+        metrics.set("bmp280_expose_repairs_total", static_cast<double>(stats.repairs));
+        metrics.set("bmp280_expose_pixels_total", static_cast<double>(stats.repaired_pixels));
+        if (stats.tile_holes != tile_holes_seen) {
+            tile_holes_seen = stats.tile_holes;
+            tiles_on_disk.clear();
+            tile_backlog = true;
+        }
+    }
+
+    int format_menu_status(char* buf, size_t len) const {
+        char span[40] = "";
+        if (overview) snprintf(span, sizeof(span), " | Overview: %.1f days", (600 << overview_level) / 86400.0);
+        int n = snprintf(buf, len, "File: %s | Interval: %ds | Port: %s | HZoom: %.2f | VZoom: %.2f | Offset: %d%s%s%s%s | Theme: %s | Press 'h' for help",
+                         filename.c_str(), save_interval, replaying ? "Replay" : fd != -1 ? "Connected" : "Disconnected",
+                         zoom_temp, vzoom_temp, offset_temp, span, paused ? " | Paused" : "",
+                         shedder.get_level() > 0 ? " | Overload: " : "", shedder.get_level() > 0 ? shedder.name() : "",
+                         theme == Theme::White ? "White" : theme == Theme::Dark ? "Dark" : "High-Contrast");
+        return std::clamp(n, 0, static_cast<int>(len) - 1);
+    }
+
+    // With the CSV sink the current file is always up to date. A new name gets the history written
+    // to it, and the sink continues appending there from the next sample on.
+    void save_data() {
+        if (csv_sink && "logs/" + filename == stream_path) {
+            add_error("Saved to " + stream_path + " (streamed)");
+            return;
+        }
+        publish_batch();
+        uint64_t next_seq = broadcast.get_next_sample_seq();
+        std::filesystem::create_directory("logs");
+        std::string temp_path = "logs/" + filename + ".tmp";
+        std::ofstream out(temp_path);
+        if (!out) {
+            add_error("Failed to open temp file: " + temp_path);
+            return;
+        }
+        for (size_t i = 0; i < history.get_size(); ++i) {
+            const auto& d = history[i];
+            out << d.temperature << csv_delimiter << d.pressure << csv_delimiter << d.timestamp << "\n";
+        }
+        out.close();
+        if (out.fail()) {
+            add_error("Failed to write data to temp file");
+            return;
+        }
+        try {
+            std::filesystem::rename(temp_path, "logs/" + filename);
+            if (csv_sink) {
+                csv_sink->retarget("logs/" + filename, next_seq);
+                stream_path = "logs/" + filename;
             }
+            add_error("Saved to logs/" + filename);
+        } catch (const std::exception& e) {
+            add_error("Failed to rename temp file: " + std::string(e.what()));
+        }
+    }
 
-            if (i == 0) {
-                XSetFont(dpy, gc, bold_font->fid);
-                set_foreground(text_color);
-                XDrawString(dpy, pixmap, gc, text_x, y, line.data(), line.length());
+    bool load_data(const std::string& path) {
+        if (!std::filesystem::exists(path)) return false;
+
+        history.clear();
+        ++data_version;
+        window_stats.clear();
+        rollups.clear();
+        range_index.clear();
+        std::ifstream in(path);
+        if (!in) {
+            add_error("Failed to open data file: " + path);
+            return false;
+        }
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream iss(line);
+            float t, p;
+            time_t ts;
+            char delim;
+            if (iss >> t >> delim >> p >> delim >> ts && delim == csv_delimiter &&
+                t >= -40.0f && t <= 85.0f && p >= 300.0f && p <= 1100.0f &&
+                ts > 0 && ts <= time(nullptr)) {
+                ingest({t, p, ts}, true);
             } else {
-                XSetFont(dpy, gc, regular_font->fid);
-                std::string str(line);
-                size_t colon_pos = str.find(": ");
-                if (colon_pos != std::string::npos) {
-                    std::string keybind = str.substr(0, colon_pos);
-                    std::string desc = str.substr(colon_pos + 2);
-                    set_foreground(keybind_color);
-                    XDrawString(dpy, pixmap, gc, text_x, y, keybind.c_str(), keybind.length());
-                    set_foreground(text_color);
-                    XDrawString(dpy, pixmap, gc, text_x + XTextWidth(regular_font, keybind.c_str(), keybind.length()) + 5, y, desc.c_str(), desc.length());
-                } else {
-                    set_foreground(text_color);
-                    XDrawString(dpy, pixmap, gc, text_x, y, line.data(), line.length());
-                }
+                add_error("Invalid data line: " + line);
             }
-            y += line_height;
         }
+        return history.get_size() > 0;
+    }
+
+    Statistics calculate_statistics() const {
+        Statistics stats = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0, 0.0f, 0.0f};
+        Aggregate temp = window_stats.get(0), press = window_stats.get(1);
+        if (temp.count == 0) return stats;
+
+        stats.min_temp = temp.min;
+        stats.max_temp = temp.max;
+        stats.avg_temp = temp.mean();
+        stats.tw_avg_temp = temp.time_weighted_mean();
+        stats.min_press = press.min;
+        stats.max_press = press.max;
+        stats.avg_press = press.mean();
+        stats.tw_avg_press = press.time_weighted_mean();
+        stats.count = temp.count;
+        return stats;
     }
 
     void load_fonts() {
@@ -774,6 +5049,8 @@ private:
             return;
         }
         out << "baud_rate=9600\n"
+            << "flow_control=none\n"
+            << "decimate_above_hz=0\n"
             << "save_interval=30\n"
             << "temp_min=-40\n"
             << "temp_max=85\n"
@@ -785,7 +5062,18 @@ private:
             << "graph_color_temp_low=blue\n"
             << "graph_color_temp_high=red\n"
             << "graph_color_press_low=green\n"
-            << "graph_color_press_high=yellow\n";
+            << "graph_color_press_high=yellow\n"
+            << "motif_window=20\n"
+            << "motif_top_k=3\n"
+            << "time_weighted=0\n"
+            << "tw_method=step\n"
+            << "sinks=csv,stdout\n"
+            << "reorder_window=0\n"
+            << "memory_budget_mb=128\n"
+            << "checkpoint_interval=60\n"
+            << "heating_base=18\n"
+            << "cooling_base=18\n"
+            << "exceed=temp>25\n";
         out.close();
         if (out.fail()) {
             add_error("Failed to write default config file: " + path);
@@ -815,6 +5103,16 @@ private:
                         config.baud_rate = B9600;
                         add_error("Invalid baud rate: " + std::to_string(baud));
                     }
+                } else if (line.find("decimate_above_hz=") == 0) {
+                    config.decimate_above_hz = std::stod(line.substr(18));
+                    if (config.decimate_above_hz < 0.0) {
+                        config.decimate_above_hz = 0.0;
+                        add_error("Invalid decimate_above_hz: " + line.substr(18));
+                    }
+                } else if (line.find("flow_control=") == 0) {
+                    auto flow = parse_flow_control(line.substr(13));
+                    if (flow) config.flow_control = *flow;
+                    else add_error("Invalid flow_control: " + line.substr(13));
                 } else if (line.find("save_interval=") == 0) {
                     config.save_interval = std::stoi(line.substr(14));
                     if (config.save_interval < 1 || config.save_interval > 3600) {
@@ -859,6 +5157,55 @@ private:
                     config.graph_colors[2] = line.substr(21);
                 } else if (line.find("graph_color_press_high=") == 0) {
                     config.graph_colors[3] = line.substr(22);
+                } else if (line.find("motif_window=") == 0) {
+                    config.motif_window = std::stoi(line.substr(13));
+                    if (config.motif_window < 4 || config.motif_window > MAX_POINTS / 2) {
+                        config.motif_window = MP_DEFAULT_WINDOW;
+                        add_error("Invalid motif_window: " + line.substr(13));
+                    }
+                } else if (line.find("checkpoint_interval=") == 0) {
+                    config.checkpoint_interval = std::stoi(line.substr(20));
+                    if (config.checkpoint_interval < 5 || config.checkpoint_interval > 3600) {
+                        config.checkpoint_interval = 60;
+                        add_error("Invalid checkpoint_interval: " + line.substr(20));
+                    }
+                } else if (line.find("sinks=") == 0) {
+                    config.sinks = line.substr(6);
+                } else if (line.find("capture_file=") == 0) {
+                    config.capture_file = line.substr(13);
+                } else if (line.find("heating_base=") == 0) {
+                    config.heating_base = std::stof(line.substr(13));
+                } else if (line.find("cooling_base=") == 0) {
+                    config.cooling_base = std::stof(line.substr(13));
+                } else if (line.find("exceed=") == 0) {
+                    auto def = AccumulatorStore::parse_definition(line.substr(7));
+                    if (def) config.exceedances.push_back(*def);
+                    else add_error("Invalid exceed: " + line.substr(7));
+                } else if (line.find("time_weighted=") == 0) {
+                    config.time_weighted = std::stoi(line.substr(14)) != 0;
+                } else if (line.find("tw_method=") == 0) {
+                    std::string method = line.substr(10);
+                    if (method == "step") config.tw_method = IntegralMethod::Step;
+                    else if (method == "trapezoid") config.tw_method = IntegralMethod::Trapezoid;
+                    else add_error("Invalid tw_method: " + method);
+                } else if (line.find("memory_budget_mb=") == 0) {
+                    config.memory_budget_mb = std::stoi(line.substr(17));
+                    if (config.memory_budget_mb < 8 || config.memory_budget_mb > 65536) {
+                        config.memory_budget_mb = MEMORY_DEFAULT_BUDGET_MB;
+                        add_error("Invalid memory_budget_mb: " + line.substr(17));
+                    }
+                } else if (line.find("reorder_window=") == 0) {
+                    config.reorder_window = std::stoi(line.substr(15));
+                    if (config.reorder_window < 0 || config.reorder_window > 3600) {
+                        config.reorder_window = 0;
+                        add_error("Invalid reorder_window: " + line.substr(15));
+                    }
+                } else if (line.find("motif_top_k=") == 0) {
+                    config.motif_top_k = std::stoi(line.substr(12));
+                    if (config.motif_top_k < 1 || config.motif_top_k > 10) {
+                        config.motif_top_k = MP_DEFAULT_TOP_K;
+                        add_error("Invalid motif_top_k: " + line.substr(12));
+                    }
                 }
             } catch (const std::exception& e) {
                 add_error("Invalid config line: " + line);
@@ -866,8 +5213,29 @@ private:
         }
 
         baud_rate = config.baud_rate;
+        flow_control = config.flow_control;
         save_interval = config.save_interval;
         csv_delimiter = config.csv_delimiter;
+        motif_window = config.motif_window;
+        capture_file = config.capture_file;
+        sink_spec = config.sinks;
+        decimator.set_threshold(config.decimate_above_hz);
+        if (decimator.enabled() && ("," + sink_spec + ",").find(",archive,") == std::string::npos)
+            sink_spec += ",archive";
+        checkpoint_interval = config.checkpoint_interval;
+        reorder.set_lateness(config.reorder_window);
+        memory.set_budget(size_t(config.memory_budget_mb) << 20);
+        motif_top_k = config.motif_top_k;
+        tw_method = config.tw_method;
+        time_weighted = {config.time_weighted, config.time_weighted};
+        window_stats.set_method(tw_method);
+        rollups.set_method(tw_method);
+        std::vector<AccumulatorDef> defs = {{"hdd", 0, false, config.heating_base, true},
+                                            {"cdd", 0, true, config.cooling_base, true}};
+        defs.insert(defs.end(), config.exceedances.begin(), config.exceedances.end());
+        accumulators.set_method(tw_method);
+        accumulators.set_definitions(std::move(defs));
+        accumulators.load("logs/accumulators.csv");
         std::copy(config.temp_range, config.temp_range + 2, temp_range);
         std::copy(config.temp_range, config.temp_range + 2, default_temp_range);
         std::copy(config.press_range, config.press_range + 2, press_range);
@@ -1000,28 +5368,64 @@ private:
             menu_highlight_color = menu_bg_color;
         }
 
-        x11->set_background(background_color);
-        XSetWindowBackground(dpy, menu_win, menu_bg_color);
-        XClearWindow(dpy, menu_win);
+        frame_valid = false;
+    }
+
+    void apply_motion() {
+        if (!pending_motion) return;
+        const XMotionEvent& m = *pending_motion;
+        metrics.add("bmp280_motion_applied_total", 1);
+        if (m.window == win) pointer_y = m.y;
+        if (selecting) {
+            selection_to = timestamp_at(selection_is_temp, m.x);
+            needs_redraw = true;
+        }
+        if (dragging) {
+            pan_remainder += drag_start_x - m.x;
+            drag_start_x = m.x;
+            int delta = pan_remainder / 10;
+            pan_remainder -= delta * 10;
+            int max_offset = static_cast<int>(history.get_size()) - static_cast<int>(MAX_POINTS / zoom_temp);
+            offset_temp = std::clamp(offset_temp + delta, 0, std::max(0, max_offset));
+            offset_press = std::clamp(offset_press + delta, 0, std::max(0, max_offset));
+            if (delta != 0) needs_redraw = true;
+        }
+        if ((selecting || dragging) && input_time_us == 0) input_time_us = now_us();
+        pending_motion.reset();
     }
 
     void handle_events() {
         while (XPending(dpy)) {
             XEvent evt;
             XNextEvent(dpy, &evt);
+            if (evt.type == MotionNotify) {
+                metrics.add("bmp280_motion_events_total", 1);
+                pending_motion = evt.xmotion;
+                continue;
+            }
+            apply_motion();
+            if (evt.type == KeyPress || evt.type == ButtonPress) input_time_us = now_us();
             if (evt.type == Expose) {
                 if (evt.xexpose.window == win) {
-                    needs_redraw = true;
-                } else if (evt.xexpose.window == menu_win) {
-                    menu_needs_redraw = true;
+                    renderer->expose(evt.xexpose);
+                    metrics.add("bmp280_expose_events_total", 1);
+                    if (!frame_valid) needs_redraw = true;
                 }
             }
+            if (evt.type == VisibilityNotify && evt.xvisibility.window == win) {
+                window_visible = evt.xvisibility.state != VisibilityFullyObscured;
+            }
+            if (evt.type == UnmapNotify && evt.xunmap.window == win) {
+                window_mapped = false;
+            }
+            if (evt.type == MapNotify && evt.xmap.window == win) {
+                window_mapped = true;
+            }
             if (evt.type == KeyPress) {
                 char keybuf[8];
                 KeySym key;
                 XLookupString(&evt.xkey, keybuf, sizeof(keybuf), &key, nullptr);
                 menu_highlight_time = time(nullptr);
-                menu_needs_redraw = true;
                 if (key == XK_q || key == XK_Q) throw std::runtime_error("User quit");
                 if (key == XK_s || key == XK_S) {
                     std::cout << "Enter filename to save (empty to keep " << filename << "): ";
@@ -1072,9 +5476,46 @@ private:
                     theme = static_cast<Theme>((static_cast<int>(theme) + 1) % 3);
                     update_theme("", "", {});
                     needs_redraw = true;
-                    menu_needs_redraw = true;
                 }
-                if (key == XK_plus || key == XK_KP_Add) {
+                if (key == XK_a || key == XK_A) {
+                    bool on_temp = pointer_y >= 40 && pointer_y <= 240;
+                    bool on_press = pointer_y >= 290 && pointer_y <= 490;
+                    if (on_temp || !on_press) time_weighted[0] = !time_weighted[0];
+                    if (on_press || !on_temp) time_weighted[1] = !time_weighted[1];
+                    needs_redraw = true;
+                }
+                if (key == XK_m || key == XK_M) {
+                    start_motif_analysis();
+                }
+                if (key == XK_i || key == XK_I) {
+                    show_hud = !show_hud;
+                    needs_redraw = true;
+                }
+                if (key == XK_o || key == XK_O) {
+                    overview = !overview;
+                    overview_pan = 0;
+                    needs_redraw = true;
+                }
+                if (key == XK_Escape && has_selection) {
+                    has_selection = false;
+                    selecting = false;
+                    needs_redraw = true;
+                }
+                if (overview && (key == XK_plus || key == XK_KP_Add)) {
+                    overview_level = std::max(TILE_MIN_LEVEL, overview_level - 1);
+                    overview_pan = 0;
+                    needs_redraw = true;
+                } else if (overview && (key == XK_minus || key == XK_KP_Subtract)) {
+                    overview_level = std::min(TILE_MAX_LEVEL, overview_level + 1);
+                    overview_pan = 0;
+                    needs_redraw = true;
+                } else if (overview && key == XK_Left) {
+                    overview_pan += 150;
+                    needs_redraw = true;
+                } else if (overview && key == XK_Right) {
+                    overview_pan = std::max(0, overview_pan - 150);
+                    needs_redraw = true;
+                } else if (key == XK_plus || key == XK_KP_Add) {
                     zoom_temp = std::min(10.0f, zoom_temp * 1.5f);
                     zoom_press = std::min(10.0f, zoom_press * 1.5f);
                     offset_temp = 0;
@@ -1114,9 +5555,8 @@ private:
                 }
             }
             if (evt.type == ButtonPress) {
-                if (evt.xbutton.window == menu_win) {
+                if (evt.xbutton.window == win && evt.xbutton.y < MENU_HEIGHT) {
                     menu_highlight_time = time(nullptr);
-                    menu_needs_redraw = true;
                     int x = evt.xbutton.x;
                     if (x < 100) {
                         std::cout << "Enter filename to save (empty to keep " << filename << "): ";
@@ -1153,7 +5593,14 @@ private:
                     }
                     bool on_temp_graph = (x >= 100 && x <= 700 && y >= 40 && y <= 240);
                     bool on_press_graph = (x >= 100 && x <= 700 && y >= 290 && y <= 490);
-                    if (evt.xbutton.button == Button1 && (on_temp_graph || on_press_graph)) {
+                    if (evt.xbutton.button == Button1 && (evt.xbutton.state & ShiftMask) && !overview &&
+                        (on_temp_graph || on_press_graph) && history.get_size() >= 2) {
+                        selecting = true;
+                        has_selection = true;
+                        selection_is_temp = on_temp_graph;
+                        selection_from = selection_to = timestamp_at(selection_is_temp, x);
+                        needs_redraw = true;
+                    } else if (evt.xbutton.button == Button1 && (on_temp_graph || on_press_graph)) {
                         if (on_temp_graph) {
                             zoom_temp = std::min(10.0f, zoom_temp * 1.5f);
                             offset_temp = 0;
@@ -1176,156 +5623,1590 @@ private:
                     } else if (evt.xbutton.button == Button2 && (on_temp_graph || on_press_graph)) {
                         dragging = true;
                         drag_start_x = x;
+                        pan_remainder = 0;
                     }
                 }
             }
             if (evt.type == ButtonRelease && evt.xbutton.button == Button2) {
                 dragging = false;
             }
-            if (evt.type == MotionNotify && dragging) {
-                int x = evt.xmotion.x;
-                int delta = (drag_start_x - x) / 10;
-                int max_offset = static_cast<int>(history.get_size()) - static_cast<int>(MAX_POINTS / zoom_temp);
-                offset_temp = std::clamp(offset_temp + delta, 0, max_offset);
-                offset_press = std::clamp(offset_press + delta, 0, max_offset);
-                drag_start_x = x;
+            if (evt.type == ButtonRelease && evt.xbutton.button == Button1) {
+                selecting = false;
+            }
+        }
+        apply_motion();
+    }
+
+    void start_motif_analysis() {
+        if (analysis_job.valid()) {
+            add_error("Motif analysis already running");
+            return;
+        }
+        if (history.get_size() < static_cast<size_t>(2 * motif_window)) {
+            add_error("Not enough data for motif analysis");
+            return;
+        }
+        if (!shedder.analytics_allowed()) {
+            if (!motif_deferred) add_error("Motif analysis deferred until load drops");
+            motif_deferred = true;
+            metrics.add("bmp280_analytics_deferred_total", 1);
+            return;
+        }
+        motif_deferred = false;
+        std::vector<DataPoint> points;
+        points.reserve(history.get_size());
+        for (size_t i = 0; i < history.get_size(); ++i) points.push_back(history[i]);
+        analysis_job = std::async(std::launch::async, [points = std::move(points), m = motif_window, k = motif_top_k]() {
+            auto result = annotate_motifs(points, true, m, k);
+            auto press = annotate_motifs(points, false, m, k);
+            result.insert(result.end(), press.begin(), press.end());
+            return result;
+        });
+        add_error("Motif analysis started");
+    }
+
+    void poll_analysis() {
+        if (!analysis_job.valid() ||
+            analysis_job.wait_for(std::chrono::seconds(0)) != std::future_status::ready) return;
+        annotations = analysis_job.get();
+        ++annotations_version;
+        add_error("Motif analysis found " + std::to_string(annotations.size()) + " annotations");
+        needs_redraw = true;
+    }
+
+    void request_raw_views() {
+        if (archive_path.empty() || envelopes.empty() || history.get_size() < 2 || !shedder.fetch_allowed()) return;
+        for (int ch = 0; ch < 2; ++ch) {
+            int start, max_points;
+            visible_window(ch == 0, start, max_points);
+            if (max_points > DECIMATE_RAW_MAX_BUCKETS) {
+                if (raw_views[ch].points) raw_views[ch] = RawView{};
+                continue;
+            }
+            time_t from = history[start].timestamp;
+            time_t to = history[std::min<size_t>(start + max_points - 1, history.get_size() - 1)].timestamp;
+            if (raw_jobs[ch].valid() || (raw_views[ch].from == from && raw_views[ch].to == to)) continue;
+            raw_jobs[ch] = std::async(std::launch::async, [this, path = archive_path, from, to]() {
+                auto points = ArchiveReader::read_range(path, from, to, RAW_FETCH_LIMIT, &block_cache);
+                return RawView{from, to, std::make_shared<const std::vector<DataPoint>>(std::move(points))};
+            });
+        }
+    }
+
+    void poll_raw_views() {
+        for (int ch = 0; ch < 2; ++ch) {
+            if (!raw_jobs[ch].valid() || raw_jobs[ch].wait_for(std::chrono::seconds(0)) != std::future_status::ready) continue;
+            raw_views[ch] = raw_jobs[ch].get();
+            metrics.add("bmp280_raw_fetches_total", 1);
+            metrics.add("bmp280_raw_fetched_points_total", static_cast<double>(raw_views[ch].points->size()));
+            needs_redraw = true;
+        }
+    }
+
+    void update_state() {
+        try_reconnect();
+        read_serial();
+        submit_serial();
+        replay_paused = paused;
+        drain_ingest();
+        reorder.drain(time(nullptr), [this](const DataPoint& p) { ingest(p); });
+        publish_batch();
+        window_stats.expire(time(nullptr));
+        if (time(nullptr) != last_memory_check) {
+            last_memory_check = time(nullptr);
+            memory.enforce();
+            if (show_hud) needs_redraw = true;
+        }
+        if (motif_deferred && shedder.analytics_allowed()) start_motif_analysis();
+        poll_analysis();
+        request_raw_views();
+        poll_raw_views();
+        request_tile_fills();
+        poll_tile_fills();
+        if (tile_backlog) {
+            tile_backlog = false;
+            ++tile_pass;
+        }
+        maintain_tiles();
+        if (!paused && difftime(time(nullptr), last_save) >= save_interval) {
+            if ("logs/" + filename != stream_path) save_data();
+            persist_analytics();
+            last_save = time(nullptr);
+            needs_redraw = true;
+        }
+        if (difftime(time(nullptr), last_checkpoint) >= checkpoint_interval) {
+            write_checkpoint();
+        }
+    }
+
+    bool can_draw() const { return window_mapped && window_visible; }
+
+    void account_load(uint64_t work) {
+        uint64_t now = now_us();
+        if (shedder.update(work, fd != -1 ? uart_totals.queued : 0, now)) {
+            add_error(std::string("Overload level: ") + shedder.name());
+            needs_redraw = true;
+        }
+        metrics.set("bmp280_overload_level", shedder.get_level());
+        metrics.set("bmp280_overload_transitions_total", static_cast<double>(shedder.get_transitions()));
+        metrics.set("bmp280_loop_work_seconds", shedder.get_work_us() / 1e6);
+        metrics.set("bmp280_frame_cost_seconds", shedder.get_frame_us() / 1e6);
+        for (int l = 0; l < 4; ++l)
+            metrics.set(std::string("bmp280_overload_seconds_total{level=\"") + LoadShedder::name(l) + "\"}", shedder.seconds_at(l));
+    }
+
+    void account_cpu() {
+        double cpu = process_cpu_seconds();
+        uint64_t now = now_us();
+        if (last_cpu_sample_us != 0) {
+            const char* state = can_draw() ? "{state=\"visible\"}" : "{state=\"hidden\"}";
+            metrics.add(std::string("bmp280_cpu_seconds_total") + state, cpu - last_cpu_seconds);
+            metrics.add(std::string("bmp280_wall_seconds_total") + state, (now - last_cpu_sample_us) / 1e6);
+        }
+        last_cpu_seconds = cpu;
+        last_cpu_sample_us = now;
+        metrics.set("bmp280_window_visible", can_draw() ? 1.0 : 0.0);
+    }
+
+public:
+    BMP280Gui(int argc, char* argv[]) : fd(-1), last_save(0) {
+        XSetErrorHandler(x11_error_handler);
+
+        std::vector<char*> args;
+        std::string replay_path;
+        for (int i = 0; i < argc; ++i) {
+            std::string arg = argv[i];
+            if (i > 0 && arg.find("--replay=") == 0) replay_path = arg.substr(9);
+            else if (i > 0 && arg.find("--replay-speed=") == 0) replay_speed = std::atof(arg.c_str() + 15);
+            else args.push_back(argv[i]);
+        }
+        argc = static_cast<int>(args.size());
+        argv = args.data();
+
+        try {
+            x11 = std::make_unique<X11Display>();
+            dpy = x11->get_display();
+            win = x11->get_window();
+            renderer = std::make_unique<FrameRenderer>(win, x11->get_pixmap());
+        } catch (const std::exception& e) {
+            std::cerr << "X11 initialization failed: " << e.what() << "\n";
+            throw;
+        }
+
+        load_fonts();
+        load_config("bmp280.ini");
+
+        if (argc > 1) filename = argv[1];
+        else {
+            char timestr[32];
+            time_t now = time(nullptr);
+            strftime(timestr, sizeof(timestr), "data_%Y%m%d_%H%M%S.csv", localtime(&now));
+            filename = timestr;
+        }
+        if (argc > 2) {
+            int baud = std::atoi(argv[2]);
+            switch (baud) {
+                case 9600: baud_rate = B9600; break;
+                case 115200: baud_rate = B115200; break;
+                default:
+                    baud_rate = B9600;
+                    add_error("Unsupported baud rate: " + std::to_string(baud));
+                    break;
+            }
+        }
+        if (argc > 3 && argv[3][0]) csv_delimiter = argv[3][0];
+
+        std::unique_ptr<CaptureReader> replay;
+        if (!replay_path.empty()) {
+            try {
+                replay = std::make_unique<CaptureReader>(replay_path);
+                replaying = true;
+                add_error("Replaying " + replay_path);
+            } catch (const std::exception& e) {
+                add_error(e.what(), true);
+            }
+        } else {
+            if (!capture_file.empty()) {
+                try {
+                    capture = std::make_unique<CaptureWriter>(capture_file);
+                } catch (const std::exception& e) {
+                    add_error(e.what(), true);
+                }
+            }
+            auto port = find_serial_port();
+            if (!port) {
+                add_error("No serial port found", true);
+            } else if (!open_serial(*port, baud_rate)) {
+                add_error("Unable to open serial port: " + *port, true);
+            }
+        }
+
+        if (load_data("logs/" + filename)) {
+            add_error("Loaded data from logs/" + filename);
+        }
+        restore_checkpoint();
+        track_memory();
+        build_graph();
+        start_sinks();
+        if (replay) replay_thread = std::thread(&BMP280Gui::run_replay, this, std::move(replay));
+    }
+
+    ~BMP280Gui() {
+        replay_stop = true;
+        if (replay_thread.joinable()) replay_thread.join();
+        submit_serial();
+        drain_ingest();
+        reorder.flush([this](const DataPoint& p) { ingest(p); });
+        decimator.flush([this](const DataPoint& p, const Envelope& e) { push_history(p, e); });
+        publish_batch();
+        broadcast.close();
+        sinks.clear();
+        csv_sink = nullptr;
+        if ("logs/" + filename != stream_path) save_data();
+        persist_analytics();
+        if (checkpoint_job.valid()) checkpoint_job.wait();
+        write_file_atomic(CHECKPOINT_PATH, build_checkpoint());
+        free_fonts();
+    }
+
+    void run() {
+        while (!window_mapped) {
+            XEvent evt;
+            XNextEvent(dpy, &evt);
+            if (evt.type == Expose) {
+                window_mapped = true;
+                needs_redraw = true;
+            }
+        }
+
+        while (true) {
+            uint64_t loop_start = now_us();
+            serial_wait_us = 0;
+            handle_events();
+            update_state();
+            graph.sync();
+
+            bool stale = needs_redraw || graph.stale(frame_node);
+            if (can_draw() && stale && shedder.frame_due(now_us())) {
+                graph.evaluate(frame_node);
+                if (needs_redraw || graph.version(frame_node) != drawn_frame) publish_frame(true);
+                frame_deferred = false;
+            } else if (can_draw()) {
+                if (stale && !frame_deferred) {
+                    frame_deferred = true;
+                    metrics.add("bmp280_frames_deferred_total", 1);
+                }
+                if (graph.stale(menu_node)) {
+                    graph.evaluate(menu_node);
+                    if (graph.version(menu_node) != drawn_menu) publish_frame(false);
+                }
+            }
+            input_time_us = 0;
+
+            account_cpu();
+            account_frames();
+            account_load(now_us() - loop_start - serial_wait_us);
+
+            if (!error_messages.empty() && difftime(time(nullptr), last_error_time) > ERROR_DISPLAY_TIME) {
+                error_messages.clear();
                 needs_redraw = true;
             }
+
+            if (!XPending(dpy)) {
+                int xfd = ConnectionNumber(dpy);
+                fd_set fds;
+                FD_ZERO(&fds);
+                FD_SET(xfd, &fds);
+                uint64_t wait = 200000;
+                if (frame_deferred) wait = std::clamp<uint64_t>(shedder.until_frame(now_us()), 1000, wait);
+                struct timeval tv = {0, static_cast<suseconds_t>(wait)};
+                select(xfd + 1, &fds, nullptr, nullptr, &tv);
+            }
+        }
+    }
+};
+
+bool read_log_range(const std::string& path, time_t from, time_t to, std::vector<DataPoint>& points) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Failed to open data file: " << path << "\n";
+        return false;
+    }
+    std::string line;
+    DataPoint point;
+    while (std::getline(in, line)) {
+        if (parse_log_line(line, point) && point.timestamp >= from && point.timestamp <= to)
+            points.push_back(point);
+    }
+    return true;
+}
+
+// Minimal FlatBuffers builder for Arrow IPC metadata. The buffer is built back to front like the
+// reference implementation: children are written first, so every offset points forward.
+class FlatBuilder {
+    std::string data;
+    std::vector<std::pair<int, uint32_t>> fields;
+    uint32_t table_start = 0;
+
+    void align(size_t after, size_t alignment) { data.insert(0, (alignment - (data.size() + after) % alignment) % alignment, '\0'); }
+
+public:
+    uint32_t size() const { return static_cast<uint32_t>(data.size()); }
+
+    template <typename T>
+    void push(T value) {
+        align(0, sizeof(T));
+        data.insert(0, reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+    void push_offset(uint32_t target) {
+        align(0, 4);
+        push<uint32_t>(size() + 4 - target);
+    }
+
+    uint32_t string(const std::string& str) {
+        align(str.size() + 1, 4);
+        data.insert(0, 1, '\0');
+        data.insert(0, str);
+        push<uint32_t>(static_cast<uint32_t>(str.size()));
+        return size();
+    }
+    uint32_t offsets(const std::vector<uint32_t>& items) {
+        for (auto it = items.rbegin(); it != items.rend(); ++it) push_offset(*it);
+        push<uint32_t>(static_cast<uint32_t>(items.size()));
+        return size();
+    }
+    // Vector of fixed-size structs given as their packed little-endian bytes, 8-byte aligned.
+    uint32_t structs(const std::string& bytes, uint32_t count) {
+        align(bytes.size(), 8);
+        data.insert(0, bytes);
+        push<uint32_t>(count);
+        return size();
+    }
+
+    void start() {
+        fields.clear();
+        table_start = size();
+    }
+    template <typename T>
+    void add(int id, T value) {
+        push(value);
+        fields.emplace_back(id, size());
+    }
+    void add_offset(int id, uint32_t target) {
+        push_offset(target);
+        fields.emplace_back(id, size());
+    }
+    uint32_t end() {
+        push<int32_t>(0);
+        uint32_t table = size();
+        int slots = 0;
+        for (const auto& f : fields) slots = std::max(slots, f.first + 1);
+        std::vector<uint16_t> vtable(2 + slots, 0);
+        vtable[0] = static_cast<uint16_t>(vtable.size() * 2);
+        vtable[1] = static_cast<uint16_t>(table - table_start);
+        for (const auto& [id, at] : fields) vtable[2 + id] = static_cast<uint16_t>(table - at);
+        for (auto it = vtable.rbegin(); it != vtable.rend(); ++it) push(*it);
+        int32_t to_vtable = static_cast<int32_t>(size() - table);
+        std::memcpy(&data[size() - table], &to_vtable, sizeof(to_vtable));
+        return table;
+    }
+
+    std::string finish(uint32_t root) {
+        align(4, 8);
+        push_offset(root);
+        return data;
+    }
+};
+
+// Writes samples as an Arrow IPC file (format version V5): timestamp[s, UTC], sensor as a dictionary
+// of utf8 names with int32 indices, temperature and pressure as float32. Rows are buffered into
+// record batches of ARROW_BATCH_ROWS, so memory stays bounded whatever the input size.
+class ArrowWriter {
+    struct Block {
+        int64_t offset;
+        int32_t metadata_length;
+        int64_t body_length;
+    };
+    struct Body {
+        std::string data;
+        std::string buffers;
+        void add(const void* bytes, size_t len) {
+            int64_t entry[2] = {static_cast<int64_t>(data.size()), static_cast<int64_t>(len)};
+            buffers.append(reinterpret_cast<const char*>(entry), sizeof(entry));
+            if (len) data.append(static_cast<const char*>(bytes), len);
+            data.append((8 - len % 8) % 8, '\0');
+        }
+    };
+
+    enum : uint8_t { TypeInt = 2, TypeFloatingPoint = 3, TypeUtf8 = 5, TypeTimestamp = 10 };
+    enum : uint8_t { HeaderSchema = 1, HeaderDictionaryBatch = 2, HeaderRecordBatch = 3 };
+    static constexpr int16_t metadata_v5 = 4;
+
+    std::ofstream out;
+    int64_t position = 0;
+    std::vector<std::string> sensors;
+    std::vector<Block> dictionaries, batches;
+    std::vector<int64_t> timestamps;
+    std::vector<int32_t> sensor_ids;
+    std::vector<float> temperatures, pressures;
+    size_t rows = 0;
+
+    void write(const void* bytes, size_t len) {
+        out.write(static_cast<const char*>(bytes), len);
+        position += len;
+    }
+
+    static uint32_t field(FlatBuilder& b, const std::string& name, uint8_t type_id, uint32_t type, uint32_t dictionary = 0) {
+        uint32_t name_off = b.string(name);
+        uint32_t children = b.offsets({});
+        b.start();
+        b.add_offset(0, name_off);
+        b.add<uint8_t>(1, 0);
+        b.add<uint8_t>(2, type_id);
+        b.add_offset(3, type);
+        if (dictionary) b.add_offset(4, dictionary);
+        b.add_offset(5, children);
+        return b.end();
+    }
+
+    static uint32_t schema(FlatBuilder& b) {
+        uint32_t utc = b.string("UTC");
+        b.start();
+        b.add<int16_t>(0, 0);
+        b.add_offset(1, utc);
+        uint32_t timestamp = field(b, "timestamp", TypeTimestamp, b.end());
+
+        b.start();
+        b.add<int32_t>(0, 32);
+        b.add<uint8_t>(1, 1);
+        uint32_t index_type = b.end();
+        b.start();
+        b.add<int64_t>(0, 0);
+        b.add_offset(1, index_type);
+        b.add<uint8_t>(2, 0);
+        b.add<int16_t>(3, 0);
+        uint32_t dictionary = b.end();
+        b.start();
+        uint32_t sensor = field(b, "sensor", TypeUtf8, b.end(), dictionary);
+
+        std::array<uint32_t, 2> floats{};
+        for (auto& f : floats) {
+            b.start();
+            b.add<int16_t>(0, 1);
+            f = b.end();
+        }
+        uint32_t temperature = field(b, "temperature", TypeFloatingPoint, floats[0]);
+        uint32_t pressure = field(b, "pressure", TypeFloatingPoint, floats[1]);
+        uint32_t list = b.offsets({timestamp, sensor, temperature, pressure});
+        b.start();
+        b.add<int16_t>(0, 0);
+        b.add_offset(1, list);
+        return b.end();
+    }
+
+    static uint32_t record_batch(FlatBuilder& b, int64_t length, const std::vector<int64_t>& nodes, const Body& body) {
+        std::string node_bytes;
+        for (int64_t n : nodes) {
+            int64_t node[2] = {n, 0};
+            node_bytes.append(reinterpret_cast<const char*>(node), sizeof(node));
         }
+        uint32_t node_off = b.structs(node_bytes, static_cast<uint32_t>(nodes.size()));
+        uint32_t buffer_off = b.structs(body.buffers, static_cast<uint32_t>(body.buffers.size() / 16));
+        b.start();
+        b.add<int64_t>(0, length);
+        b.add_offset(1, node_off);
+        b.add_offset(2, buffer_off);
+        return b.end();
     }
 
-    void update_state() {
-        try_reconnect();
-        read_serial();
-        if (!paused && difftime(time(nullptr), last_save) >= save_interval) {
-            save_data();
-            last_save = time(nullptr);
-            needs_redraw = true;
-            menu_needs_redraw = true;
-        }
+    static std::string message(FlatBuilder& b, uint8_t header_type, uint32_t header, int64_t body_length) {
+        b.start();
+        b.add<int16_t>(0, metadata_v5);
+        b.add<uint8_t>(1, header_type);
+        b.add_offset(2, header);
+        b.add<int64_t>(3, body_length);
+        return b.finish(b.end());
     }
 
-    void render() {
-        set_foreground(background_color);
-        XFillRectangle(dpy, pixmap, gc, 0, 0, WIDTH, HEIGHT);
-        draw_graph(100, 40, 600, 200, true, 18.0f, colors[1], colors[0]);
-        draw_graph(100, 290, 600, 200, false, 0.0f, colors[2], colors[3]);
-        draw_footer();
-        draw_errors();
-        draw_help();
-        x11->copy_pixmap_to_window();
-        needs_redraw = false;
+    Block write_message(const std::string& metadata, const std::string& body) {
+        Block block{position, 0, static_cast<int64_t>(body.size())};
+        uint32_t continuation = 0xFFFFFFFF;
+        int32_t length = static_cast<int32_t>((metadata.size() + 7) / 8 * 8);
+        write(&continuation, sizeof(continuation));
+        write(&length, sizeof(length));
+        write(metadata.data(), metadata.size());
+        write("\0\0\0\0\0\0\0", length - metadata.size());
+        write(body.data(), body.size());
+        block.metadata_length = 8 + length;
+        return block;
+    }
+
+    void flush_batch() {
+        if (rows == 0) return;
+        Body body;
+        body.add(nullptr, 0);
+        body.add(timestamps.data(), rows * sizeof(int64_t));
+        body.add(nullptr, 0);
+        body.add(sensor_ids.data(), rows * sizeof(int32_t));
+        body.add(nullptr, 0);
+        body.add(temperatures.data(), rows * sizeof(float));
+        body.add(nullptr, 0);
+        body.add(pressures.data(), rows * sizeof(float));
+        FlatBuilder b;
+        int64_t n = static_cast<int64_t>(rows);
+        uint32_t batch = record_batch(b, n, {n, n, n, n}, body);
+        batches.push_back(write_message(message(b, HeaderRecordBatch, batch, body.data.size()), body.data));
+        timestamps.clear();
+        sensor_ids.clear();
+        temperatures.clear();
+        pressures.clear();
+        rows = 0;
     }
 
 public:
-    BMP280Gui(int argc, char* argv[]) : menu_win(0), menu_gc(0), fd(-1), last_save(0) {
-        XSetErrorHandler(x11_error_handler);
+    // The sensor dictionary is written up front, so all sensor names must be known when opening.
+    ArrowWriter(const std::string& path, std::vector<std::string> sensor_names)
+        : out(path, std::ios::binary | std::ios::trunc), sensors(std::move(sensor_names)) {
+        if (!out) throw std::runtime_error("Failed to open output: " + path);
+        write("ARROW1\0\0", 8);
+        FlatBuilder b;
+        uint32_t s = schema(b);
+        write_message(message(b, HeaderSchema, s, 0), "");
 
-        try {
-            x11 = std::make_unique<X11Display>();
-            dpy = x11->get_display();
-            win = x11->get_window();
-            gc = x11->get_gc();
-            pixmap = x11->get_pixmap();
-        } catch (const std::exception& e) {
-            std::cerr << "X11 initialization failed: " << e.what() << "\n";
-            throw;
+        Body body;
+        std::vector<int32_t> offsets = {0};
+        std::string names;
+        for (const auto& name : sensors) {
+            names += name;
+            offsets.push_back(static_cast<int32_t>(names.size()));
         }
+        body.add(nullptr, 0);
+        body.add(offsets.data(), offsets.size() * sizeof(int32_t));
+        body.add(names.data(), names.size());
+        FlatBuilder d;
+        int64_t count = static_cast<int64_t>(sensors.size());
+        uint32_t data = record_batch(d, count, {count}, body);
+        d.start();
+        d.add<int64_t>(0, 0);
+        d.add_offset(1, data);
+        d.add<uint8_t>(2, 0);
+        uint32_t dictionary = d.end();
+        dictionaries.push_back(write_message(message(d, HeaderDictionaryBatch, dictionary, body.data.size()), body.data));
+    }
 
-        int screen = DefaultScreen(dpy);
-        menu_win = XCreateSimpleWindow(dpy, win, 0, 1, WIDTH, 30, 0,
-                                       BlackPixel(dpy, screen), WhitePixel(dpy, screen));
-        XSelectInput(dpy, menu_win, ExposureMask | ButtonPressMask);
-        XMapWindow(dpy, menu_win);
-        menu_gc = XCreateGC(dpy, menu_win, 0, nullptr);
-        XSetForeground(dpy, menu_gc, BlackPixel(dpy, screen));
+    void add(int32_t sensor, const DataPoint& p) {
+        timestamps.push_back(static_cast<int64_t>(p.timestamp));
+        sensor_ids.push_back(sensor);
+        temperatures.push_back(p.temperature);
+        pressures.push_back(p.pressure);
+        if (++rows == ARROW_BATCH_ROWS) flush_batch();
+    }
 
-        load_fonts();
-        load_config("bmp280.ini");
+    // Writes the end-of-stream marker and the footer; returns false if any write failed.
+    bool close() {
+        flush_batch();
+        uint32_t eos[2] = {0xFFFFFFFF, 0};
+        write(eos, sizeof(eos));
+        FlatBuilder b;
+        auto blocks = [&b](const std::vector<Block>& list) {
+            std::string bytes;
+            for (const auto& block : list) {
+                int32_t pad = 0;
+                bytes.append(reinterpret_cast<const char*>(&block.offset), 8);
+                bytes.append(reinterpret_cast<const char*>(&block.metadata_length), 4);
+                bytes.append(reinterpret_cast<const char*>(&pad), 4);
+                bytes.append(reinterpret_cast<const char*>(&block.body_length), 8);
+            }
+            return b.structs(bytes, static_cast<uint32_t>(list.size()));
+        };
+        uint32_t s = schema(b);
+        uint32_t dicts = blocks(dictionaries);
+        uint32_t records = blocks(batches);
+        b.start();
+        b.add<int16_t>(0, metadata_v5);
+        b.add_offset(1, s);
+        b.add_offset(2, dicts);
+        b.add_offset(3, records);
+        std::string footer = b.finish(b.end());
+        int32_t footer_length = static_cast<int32_t>(footer.size());
+        write(footer.data(), footer.size());
+        write(&footer_length, sizeof(footer_length));
+        write("ARROW1", 6);
+        out.close();
+        return !out.fail();
+    }
 
-        if (argc > 1) filename = argv[1];
-        else {
-            char timestr[32];
-            time_t now = time(nullptr);
-            strftime(timestr, sizeof(timestr), "data_%Y%m%d_%H%M%S.csv", localtime(&now));
-            filename = timestr;
+    size_t batch_count() const { return batches.size(); }
+};
+
+// Calls emit for every sample of a CSV log or a binary archive with from <= timestamp <= to.
+template <typename Emit>
+bool for_each_sample(const std::string& path, time_t from, time_t to, Emit emit) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cerr << "Failed to open data file: " << path << "\n";
+        return false;
+    }
+    char magic[8] = {};
+    if (in.read(magic, sizeof(magic)) && std::memcmp(magic, ARCHIVE_MAGIC, sizeof(magic)) == 0) {
+        ArchiveReader::scan(path, from, to, 0, nullptr, emit);
+        return true;
+    }
+    in.clear();
+    in.seekg(0);
+    std::string line;
+    DataPoint point;
+    while (std::getline(in, line)) {
+        if (parse_log_line(line, point) && point.timestamp >= from && point.timestamp <= to) emit(point);
+    }
+    return true;
+}
+
+int tool_motifs(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " --motifs <file.csv> [temp|press] [window] [top_k] [from_ts] [to_ts]\n";
+        return 1;
+    }
+    bool is_temp = argc <= 3 || std::string(argv[3]) != "press";
+    int window = argc > 4 ? std::atoi(argv[4]) : MP_DEFAULT_WINDOW;
+    int top_k = argc > 5 ? std::atoi(argv[5]) : MP_DEFAULT_TOP_K;
+    time_t from = argc > 6 ? std::atoll(argv[6]) : 0;
+    time_t to = argc > 7 ? std::atoll(argv[7]) : std::numeric_limits<time_t>::max();
+    if (window < 4 || top_k < 1) {
+        std::cerr << "Invalid window or top_k\n";
+        return 1;
+    }
+
+    std::vector<DataPoint> points;
+    if (!read_log_range(argv[2], from, to, points)) return 1;
+    if (points.size() < static_cast<size_t>(2 * window)) {
+        std::cerr << "Not enough samples (" << points.size() << ") for window " << window << "\n";
+        return 1;
+    }
+
+    for (const auto& a : annotate_motifs(points, is_temp, window, top_k)) {
+        std::cout << (a.is_motif ? "motif " : "discord ") << a.rank << ": "
+                  << format_time(a.start) << " .. " << format_time(a.end)
+                  << " (distance " << std::fixed << std::setprecision(3) << a.distance << ")\n";
+    }
+    return 0;
+}
+
+void write_aligned_block(const AlignedBlock& block, char delimiter) {
+    for (size_t row = 0; row < block.timestamps.size(); ++row) {
+        std::cout << block.timestamps[row];
+        for (const auto& column : block.columns) {
+            std::cout << delimiter;
+            if (!std::isnan(column[row])) std::cout << column[row];
         }
-        if (argc > 2) {
-            int baud = std::atoi(argv[2]);
-            switch (baud) {
-                case 9600: baud_rate = B9600; break;
-                case 115200: baud_rate = B115200; break;
-                default:
-                    baud_rate = B9600;
-                    add_error("Unsupported baud rate: " + std::to_string(baud));
-                    break;
+        std::cout << "\n";
+    }
+}
+
+int tool_resample(int argc, char* argv[]) {
+    if (argc < 5) {
+        std::cerr << "Usage: " << argv[0] << " --resample <step_s> <last|linear|mean> <file.csv>... [--lookahead=s]\n";
+        return 1;
+    }
+    time_t step = std::atoll(argv[2]);
+    auto mode = Resampler::parse_mode(argv[3]);
+    if (step < 1 || !mode) {
+        std::cerr << "Invalid step or resample mode\n";
+        return 1;
+    }
+    time_t lookahead = 10 * step;
+    std::vector<std::unique_ptr<std::ifstream>> inputs;
+    std::cout << "timestamp";
+    for (int i = 4; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.find("--lookahead=") == 0) {
+            lookahead = std::atoll(arg.c_str() + 12);
+            continue;
+        }
+        inputs.push_back(std::make_unique<std::ifstream>(arg));
+        if (!*inputs.back()) {
+            std::cerr << "Failed to open data file: " << arg << "\n";
+            return 1;
+        }
+        std::string name = std::filesystem::path(arg).stem().string();
+        std::cout << "," << name << ".temperature," << name << ".pressure";
+    }
+    std::cout << "\n";
+
+    Resampler resampler(2 * inputs.size(), step, *mode, lookahead);
+    std::vector<std::optional<DataPoint>> heads(inputs.size());
+    auto advance = [&](size_t i) {
+        std::string line;
+        DataPoint point;
+        heads[i].reset();
+        while (std::getline(*inputs[i], line)) {
+            if (parse_log_line(line, point)) {
+                heads[i] = point;
+                return;
             }
         }
-        if (argc > 3 && argv[3][0]) csv_delimiter = argv[3][0];
+    };
+    for (size_t i = 0; i < inputs.size(); ++i) advance(i);
 
-        auto port = find_serial_port();
-        if (!port) {
-            add_error("No serial port found", true);
-        } else if (!open_serial(*port, baud_rate)) {
-            add_error("Unable to open serial port: " + *port, true);
+    AlignedBlock block;
+    while (true) {
+        std::optional<size_t> next;
+        for (size_t i = 0; i < heads.size(); ++i) {
+            if (heads[i] && (!next || heads[i]->timestamp < heads[*next]->timestamp)) next = i;
         }
+        if (!next) break;
+        resampler.push(2 * *next, heads[*next]->timestamp, heads[*next]->temperature);
+        resampler.push(2 * *next + 1, heads[*next]->timestamp, heads[*next]->pressure);
+        advance(*next);
+        if (resampler.pop(block)) write_aligned_block(block, ',');
+    }
+    if (resampler.pop(block, true)) write_aligned_block(block, ',');
+    return 0;
+}
 
-        if (load_data("logs/" + filename)) {
-            add_error("Loaded data from logs/" + filename);
+void write_rollup_buckets(const std::vector<RollupBucket>& buckets) {
+    for (const auto& b : buckets) {
+        const auto& t = b.channels[0];
+        const auto& p = b.channels[1];
+        std::cout << format_time(b.start) << "," << t.count << std::fixed << std::setprecision(3)
+                  << "," << t.mean() << "," << t.time_weighted_mean() << "," << t.min << "," << t.max
+                  << "," << p.mean() << "," << p.time_weighted_mean() << "," << p.min << "," << p.max
+                  << "," << std::setprecision(0) << t.duration << "\n";
+    }
+}
+
+int tool_rollups(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " --rollups <file.csv> [hour|day|month] [step|trapezoid]\n";
+        return 1;
+    }
+    auto level = RollupStore::parse_level(argc > 3 ? argv[3] : "hour");
+    std::string method = argc > 4 ? argv[4] : "step";
+    if (!level || (method != "step" && method != "trapezoid")) {
+        std::cerr << "Invalid rollup level or integral method\n";
+        return 1;
+    }
+    std::ifstream in(argv[2]);
+    if (!in) {
+        std::cerr << "Failed to open data file: " << argv[2] << "\n";
+        return 1;
+    }
+
+    RollupStore rollups(method == "step" ? IntegralMethod::Step : IntegralMethod::Trapezoid);
+    std::cout << "start,count,temp_avg,temp_twa,temp_min,temp_max,press_avg,press_twa,press_min,press_max,covered_s\n";
+    std::string line;
+    DataPoint point;
+    while (std::getline(in, line)) {
+        if (!parse_log_line(line, point)) continue;
+        rollups.add(point);
+        write_rollup_buckets(rollups.take_closed(*level));
+    }
+    write_rollup_buckets(rollups.buckets(*level));
+    return 0;
+}
+
+int tool_accumulators(int argc, char* argv[]) {
+    std::string path = argc > 2 ? argv[2] : "logs/accumulators.csv";
+    std::string level = argc > 3 ? argv[3] : "day";
+    if (!RollupStore::parse_level(level)) {
+        std::cerr << "Usage: " << argv[0] << " --accumulators [accumulators.csv] [hour|day|month]\n";
+        return 1;
+    }
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Failed to open accumulators: " << path << "\n";
+        return 1;
+    }
+    std::vector<std::string> names;
+    std::map<time_t, std::map<std::string, double>> rows;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream iss(line);
+        std::string row_level, start, name, value;
+        if (!std::getline(iss, row_level, ',') || row_level != level || !std::getline(iss, start, ',') ||
+            !std::getline(iss, name, ',') || !std::getline(iss, value)) continue;
+        if (std::find(names.begin(), names.end(), name) == names.end()) names.push_back(name);
+        rows[std::atoll(start.c_str())][name] = std::atof(value.c_str());
+    }
+    std::cout << "start";
+    for (const auto& name : names) std::cout << "," << name;
+    std::cout << "\n" << std::fixed << std::setprecision(3);
+    for (const auto& [start, values] : rows) {
+        std::cout << format_time(start);
+        for (const auto& name : names) {
+            auto it = values.find(name);
+            std::cout << "," << (it != values.end() ? it->second : 0.0);
         }
+        std::cout << "\n";
     }
+    return 0;
+}
 
-    ~BMP280Gui() {
-        save_data();
-        free_fonts();
-        if (menu_gc) XFreeGC(dpy, menu_gc);
-        if (menu_win) XDestroyWindow(dpy, menu_win);
+int tool_merge(int argc, char* argv[]) {
+    if (argc < 4) {
+        std::cerr << "Usage: " << argv[0] << " --merge <out.csv> <in.csv>... [--tolerance=s] [--epsilon=v]\n";
+        return 1;
+    }
+    std::string out_path = argv[2];
+    std::vector<std::string> inputs;
+    time_t tolerance = 1;
+    float epsilon = 0.05f;
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.find("--tolerance=") == 0) tolerance = std::atoll(arg.c_str() + 12);
+        else if (arg.find("--epsilon=") == 0) epsilon = std::atof(arg.c_str() + 10);
+        else inputs.push_back(arg);
     }
 
-    void run() {
-        GuiState current_state = {zoom_temp, zoom_press, vzoom_temp, vzoom_press, offset_temp, offset_press, static_cast<int>(theme), show_help, paused, selected_help_item, history.get_size()};
-        GuiState last_state = current_state;
+    try {
+        LogMerger merger(inputs, tolerance, epsilon);
+        std::string temp_path = out_path + ".tmp";
+        std::ofstream out(temp_path);
+        if (!out) {
+            std::cerr << "Failed to open output: " << temp_path << "\n";
+            return 1;
+        }
+        DataPoint p;
+        size_t written = 0;
+        while (merger.next(p)) {
+            out << p.temperature << ',' << p.pressure << ',' << p.timestamp << "\n";
+            ++written;
+        }
+        out.close();
+        if (out.fail()) {
+            std::cerr << "Failed to write output: " << temp_path << "\n";
+            return 1;
+        }
+        std::filesystem::rename(temp_path, out_path);
+        std::cout << "Merged " << inputs.size() << " files: " << merger.get_read_count() << " samples read, "
+                  << written << " written, " << merger.get_duplicates() << " duplicates, "
+                  << merger.get_out_of_order() << " out-of-order lines skipped\n";
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
 
-        while (!window_mapped) {
-            XEvent evt;
-            XNextEvent(dpy, &evt);
-            if (evt.type == Expose) {
-                window_mapped = true;
-                needs_redraw = true;
-                menu_needs_redraw = true;
+int tool_export_arrow(int argc, char* argv[]) {
+    if (argc < 4) {
+        std::cerr << "Usage: " << argv[0] << " --export-arrow <out.arrow> [sensor=]<log.csv|archive.bin>... [--from=ts] [--to=ts]"
+                  << " [--step=s [--resample=last|linear|mean]]\n";
+        return 1;
+    }
+    std::string out_path = argv[2];
+    std::vector<std::pair<int32_t, std::string>> inputs;
+    std::vector<std::string> sensors;
+    time_t from = 0, to = std::numeric_limits<time_t>::max(), step = 0;
+    ResampleMode mode = ResampleMode::Linear;
+    for (int i = 3; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.find("--from=") == 0) from = std::atoll(arg.c_str() + 7);
+        else if (arg.find("--to=") == 0) to = std::atoll(arg.c_str() + 5);
+        else if (arg.find("--step=") == 0) step = std::atoll(arg.c_str() + 7);
+        else if (arg.find("--resample=") == 0) {
+            auto parsed = Resampler::parse_mode(arg.substr(11));
+            if (!parsed) {
+                std::cerr << "Invalid resample mode: " << arg.substr(11) << "\n";
+                return 1;
             }
+            mode = *parsed;
+        } else {
+            size_t eq = arg.find('=');
+            std::string path = eq == std::string::npos ? arg : arg.substr(eq + 1);
+            std::string sensor = eq == std::string::npos ? std::filesystem::path(arg).stem().string() : arg.substr(0, eq);
+            auto it = std::find(sensors.begin(), sensors.end(), sensor);
+            if (it == sensors.end()) it = sensors.insert(sensors.end(), sensor);
+            inputs.emplace_back(static_cast<int32_t>(it - sensors.begin()), path);
         }
+    }
 
-        while (true) {
-            handle_events();
-            update_state();
+    std::string temp_path = out_path + ".tmp";
+    auto fail = [&temp_path]() {
+        std::error_code ec;
+        std::filesystem::remove(temp_path, ec);
+        return 1;
+    };
+    try {
+        ArrowWriter writer(temp_path, sensors);
+        size_t rows = 0;
+        // With a step, every sensor gets one row per grid timestamp from a Resampler, so the file holds
+        // aligned blocks instead of each sensor's raw sample times.
+        std::vector<std::pair<int32_t, DataPoint>> merged;
+        for (const auto& [sensor, path] : inputs) {
+            bool ok = for_each_sample(path, from, to, [&, id = sensor](const DataPoint& p) {
+                if (step > 0) {
+                    merged.emplace_back(id, p);
+                    return;
+                }
+                writer.add(id, p);
+                ++rows;
+            });
+            if (!ok) return fail();
+        }
+        if (step > 0) {
+            std::stable_sort(merged.begin(), merged.end(),
+                             [](const auto& a, const auto& b) { return a.second.timestamp < b.second.timestamp; });
+            Resampler resampler(2 * sensors.size(), step, mode, 10 * step);
+            AlignedBlock block;
+            auto emit = [&] {
+                for (size_t j = 0; j < block.timestamps.size(); ++j)
+                    for (size_t k = 0; k < sensors.size(); ++k, ++rows)
+                        writer.add(static_cast<int32_t>(k), {block.columns[2 * k][j], block.columns[2 * k + 1][j], block.timestamps[j]});
+            };
+            for (const auto& [sensor, p] : merged) {
+                resampler.push(2 * sensor, p.timestamp, p.temperature);
+                resampler.push(2 * sensor + 1, p.timestamp, p.pressure);
+                if (resampler.pop(block)) emit();
+            }
+            if (resampler.pop(block, true)) emit();
+        }
+        if (!writer.close()) {
+            std::cerr << "Failed to write output: " << temp_path << "\n";
+            return fail();
+        }
+        std::filesystem::rename(temp_path, out_path);
+        std::cout << "Exported " << rows << " samples from " << inputs.size() << " files (" << sensors.size()
+                  << " sensors) in " << writer.batch_count() << " record batches\n";
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return fail();
+    }
+    return 0;
+}
+
+int tool_replay(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " --replay <capture.bin> [speed, default 1, 0 for max]\n";
+        return 1;
+    }
+    double speed = argc > 3 ? std::atof(argv[3]) : 1.0;
+    try {
+        CaptureReader reader(argv[2]);
+        time_t chunk_time = 0;
+        size_t samples = 0, errors = 0, chunks = 0, bytes = 0;
+        SampleParser parser(
+            [&](float temp, float press) {
+                std::cout << temp << ',' << press << ',' << chunk_time << "\n";
+                ++samples;
+            },
+            [&](const std::string& msg) {
+                std::cerr << format_time(chunk_time) << ": " << msg << "\n";
+                ++errors;
+            });
+        uint64_t chunk_us, origin_us = 0, start_us = now_us();
+        double parse_seconds = 0.0;
+        std::string chunk;
+        while (reader.next(chunk_us, chunk)) {
+            if (origin_us == 0) origin_us = chunk_us;
+            if (speed > 0.0) {
+                double due = (chunk_us - origin_us) / speed;
+                double elapsed = static_cast<double>(now_us() - start_us);
+                if (due > elapsed) std::this_thread::sleep_for(std::chrono::microseconds(static_cast<int64_t>(due - elapsed)));
+            }
+            chunk_time = static_cast<time_t>(chunk_us / 1000000u);
+            auto t0 = std::chrono::steady_clock::now();
+            parser.feed(chunk.data(), chunk.size());
+            parse_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            ++chunks;
+            bytes += chunk.size();
+        }
+        std::cerr << "Replayed " << chunks << " chunks, " << bytes << " bytes: " << samples << " samples, "
+                  << errors << " parse errors, parser " << std::fixed << std::setprecision(1)
+                  << (parse_seconds > 0.0 ? bytes / parse_seconds / 1e6 : 0.0) << " MB/s\n";
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
 
-            current_state = {zoom_temp, zoom_press, vzoom_temp, vzoom_press, offset_temp, offset_press, static_cast<int>(theme), show_help, paused, selected_help_item, history.get_size()};
-            bool menu_highlight_changed = difftime(time(nullptr), menu_highlight_time) <= HIGHLIGHT_DURATION;
+struct SimulatedDevice {
+    int master;
+    FlowControl flow;
+    int rate_hz;
+    double duration;
+    std::atomic<bool> done{false};
+    uint64_t generated = 0;
+    uint64_t dropped_bytes = 0;
+    uint64_t xoffs = 0;
+    double blocked_seconds = 0.0;
+    bool host_ready = true;
 
-            if (needs_redraw || current_state != last_state) {
-                render();
-                last_state = current_state;
+    // Picks up XOFF (0x13) / XON (0x11) sent by the host; nothing else is ever written to the port.
+    void read_flow_chars() {
+        unsigned char c[64];
+        ssize_t n;
+        while ((n = read(master, c, sizeof(c))) > 0)
+            for (ssize_t i = 0; i < n; ++i) {
+                if (c[i] == 0x13 && host_ready) ++xoffs;
+                if (c[i] == 0x13) host_ready = false;
+                if (c[i] == 0x11) host_ready = true;
             }
+    }
 
-            if (menu_needs_redraw || menu_highlight_changed) {
-                draw_menu_bar();
-                XFlush(dpy);
-                menu_needs_redraw = false;
+    // A pty has no RTS/CTS lines, so rtscts is approximated by blocking until the pty accepts data.
+    // xonxoff pauses only on XOFF from the host and then resumes its normal sample period, like the
+    // firmware's loop; bytes the host cannot take anyway are lost, as they are without flow control.
+    void run() {
+        uint64_t start = now_us(), period = 1000000u / rate_hz, due = start;
+        for (uint64_t seq = 0; now_us() - start < duration * 1e6; ++seq, due += period) {
+            if (now_us() < due) std::this_thread::sleep_for(std::chrono::microseconds(due - now_us()));
+            char msg[128];
+            int n = snprintf(msg, sizeof(msg), "Temp: %.2f \xc2\xb0""C\r\nPressure: %.2f hPa\r\nAltitude: 110.00 m\r\n\r\n",
+                             20.0 + (seq % 6000) / 100.0, 1000.0 + (seq % 7) / 10.0);
+            ++generated;
+            if (flow == FlowControl::XonXoff) {
+                uint64_t t0 = now_us();
+                for (read_flow_chars(); !host_ready; read_flow_chars()) {
+                    pollfd p = {master, POLLIN, 0};
+                    poll(&p, 1, 100);
+                }
+                blocked_seconds += (now_us() - t0) / 1e6;
+                due = std::max(due, now_us());
+            }
+            for (int off = 0; off < n;) {
+                ssize_t w = write(master, msg + off, n - off);
+                if (w > 0) {
+                    off += w;
+                    continue;
+                }
+                if (flow != FlowControl::RtsCts) {
+                    dropped_bytes += n - off;
+                    break;
+                }
+                uint64_t t0 = now_us();
+                pollfd p = {master, POLLOUT, 0};
+                poll(&p, 1, 100);
+                blocked_seconds += (now_us() - t0) / 1e6;
             }
+        }
+        done = true;
+    }
+};
 
-            if (!error_messages.empty() && difftime(time(nullptr), last_error_time) > ERROR_DISPLAY_TIME) {
-                error_messages.clear();
-                needs_redraw = true;
+int tool_simulate(int argc, char* argv[]) {
+    FlowControl flow = FlowControl::RtsCts;
+    if (argc > 2) {
+        auto parsed = parse_flow_control(argv[2]);
+        if (!parsed) {
+            std::cerr << "Invalid flow control: " << argv[2] << "\n";
+            return 1;
+        }
+        flow = *parsed;
+    }
+    int rate_hz = argc > 3 ? std::atoi(argv[3]) : 200;
+    double stall = argc > 4 ? std::atof(argv[4]) : 5.0;
+    if (rate_hz < 1 || rate_hz > 100000 || stall < 0.0) {
+        std::cerr << "Usage: " << argv[0] << " --simulate [none|rtscts|xonxoff] [rate_hz] [stall_s]\n";
+        return 1;
+    }
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (master == -1 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        std::cerr << "Failed to create pty: " << strerror(errno) << "\n";
+        return 1;
+    }
+    std::unique_ptr<SerialPort> port;
+    try {
+        port = std::make_unique<SerialPort>(ptsname(master), B115200, flow);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        close(master);
+        return 1;
+    }
+
+    SimulatedDevice device{master, flow, rate_hz, stall + 4.0};
+    std::thread device_thread(&SimulatedDevice::run, &device);
+
+    // A UART driver sends XOFF when its receive buffer nears full and XON once it drains, whether or
+    // not the application is reading; the pty driver never does, so this thread plays that part.
+    int fd = port->get();
+    std::thread throttle_thread;
+    if (flow == FlowControl::XonXoff)
+        throttle_thread = std::thread([&device, fd] {
+            bool throttled = false;
+            while (!device.done) {
+                int queued = 0;
+                ioctl(fd, FIONREAD, &queued);
+                if (!throttled && queued > 2048) throttled = tcflow(fd, TCIOFF) == 0;
+                else if (throttled && queued < 512) throttled = tcflow(fd, TCION) != 0;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
             }
+            if (throttled) tcflow(fd, TCION);
+        });
+
+    uint64_t received = 0, lost = 0, parse_errors = 0;
+    std::optional<int> last_seq;
+    SampleParser parser(
+        [&](float temp, float) {
+            int seq = static_cast<int>(std::lround((temp - 20.0f) * 100.0f));
+            if (last_seq) lost += (seq - *last_seq - 1 + 6000) % 6000;
+            last_seq = seq;
+            ++received;
+        },
+        [&](const std::string&) { ++parse_errors; });
+
+    uint64_t start = now_us(), last_data = start;
+    bool stalled = false;
+    int absorbed = 0;
+    while (!device.done || now_us() - last_data < 500000) {
+        if (!stalled && now_us() - start > 2000000) {
+            stalled = true;
+            std::this_thread::sleep_for(std::chrono::microseconds(static_cast<uint64_t>(stall * 1e6)));
+            absorbed = port->counters().queued;
+        }
+        fd_set set;
+        FD_ZERO(&set);
+        FD_SET(fd, &set);
+        timeval timeout = {0, 100000};
+        if (select(fd + 1, &set, nullptr, nullptr, &timeout) <= 0) continue;
+        for (int i = 0; i < SERIAL_MAX_READS; ++i) {
+            if (parser.free_space() == 0) parser.reset();
+            int len = read(fd, parser.write_ptr(), parser.free_space());
+            if (len <= 0) break;
+            parser.commit(len);
+            last_data = now_us();
+        }
+    }
+    device_thread.join();
+    if (throttle_thread.joinable()) throttle_thread.join();
+    port.reset();
+    close(master);
+
+    const char* names[] = {"none", "rtscts", "xonxoff"};
+    std::cout << "flow control:      " << names[static_cast<int>(flow)] << "\n"
+              << "consumer stall:    " << stall << " s\n"
+              << "generated:         " << device.generated << "\n"
+              << "received:          " << received << "\n"
+              << "lost:              " << lost + (device.generated - std::min(device.generated, received + lost)) << "\n"
+              << "parse errors:      " << parse_errors << "\n"
+              << "dropped at device: " << device.dropped_bytes << " bytes\n"
+              << "device held off:   " << std::fixed << std::setprecision(2) << device.blocked_seconds << " s\n"
+              << "XOFF received:     " << device.xoffs << "\n"
+              << "absorbed by tty:   " << absorbed << " bytes\n";
+    if (flow == FlowControl::RtsCts)
+        std::cout << "note: a pty has no RTS/CTS lines; the device waited for the pty to accept data\n";
+    bool ok = received == device.generated && parse_errors == 0;
+    return flow == FlowControl::Off || ok ? 0 : 2;
+}
+
+struct SourceBatch {
+    int source = 0;
+    uint64_t seq = 0;
+    std::vector<DataPoint> points;
+};
+
+// Mutex-protected deque with the same interface, used as the baseline in --bench-queue.
+class LockedQueue {
+    std::deque<SourceBatch> items;
+    size_t capacity;
+    std::mutex mutex;
+
+public:
+    explicit LockedQueue(size_t capacity) : capacity(capacity) {}
+
+    bool try_push(SourceBatch* batch, size_t n) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (items.size() + n > capacity) return false;
+        for (size_t i = 0; i < n; ++i) items.push_back(std::move(batch[i]));
+        return true;
+    }
 
-            struct timeval tv = {0, 200000};
-            select(0, nullptr, nullptr, nullptr, &tv);
+    template <typename Consume>
+    size_t pop(Consume consume, size_t max = SIZE_MAX) {
+        std::deque<SourceBatch> taken;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            size_t n = std::min(max, items.size());
+            taken.insert(taken.end(), std::make_move_iterator(items.begin()), std::make_move_iterator(items.begin() + n));
+            items.erase(items.begin(), items.begin() + n);
         }
+        for (auto& batch : taken) consume(std::move(batch));
+        return taken.size();
     }
 };
 
+struct QueueBenchResult {
+    uint64_t samples = 0;
+    uint64_t out_of_order = 0;
+    uint64_t full_retries = 0;
+    double seconds = 0.0;
+};
+
+// Each producer stands in for one sensor reader: it publishes `publish` batches of `points` samples
+// per push, and the single consumer checks that every source's batches arrive complete and in order.
+template <typename Queue>
+QueueBenchResult bench_queue(Queue& queue, int producers, double seconds, int points, int publish) {
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> retries{0};
+    std::vector<std::thread> threads;
+    for (int id = 0; id < producers; ++id) {
+        threads.emplace_back([&, id] {
+            std::vector<SourceBatch> out(publish);
+            uint64_t seq = 0, local_retries = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (auto& b : out) {
+                    b.source = id;
+                    b.seq = seq++;
+                    b.points.assign(points, DataPoint{20.0f, 1013.0f, static_cast<time_t>(b.seq)});
+                }
+                while (!queue.try_push(out.data(), out.size())) {
+                    ++local_retries;
+                    if (stop.load(std::memory_order_relaxed)) break;
+                    std::this_thread::yield();
+                }
+            }
+            retries += local_retries;
+        });
+    }
+
+    QueueBenchResult r;
+    std::vector<uint64_t> expected(producers, 0);
+    uint64_t start = now_us();
+    auto consume = [&](SourceBatch&& b) {
+        if (b.seq != expected[b.source]) ++r.out_of_order;
+        expected[b.source] = b.seq + 1;
+        r.samples += b.points.size();
+    };
+    while (now_us() - start < seconds * 1e6) {
+        if (queue.pop(consume, 256) == 0) std::this_thread::yield();
+    }
+    r.seconds = (now_us() - start) / 1e6;
+    stop = true;
+    for (auto& t : threads) t.join();
+    while (queue.pop(consume) > 0) {
+    }
+    r.full_retries = retries;
+    return r;
+}
+
+int tool_bench_queue(int argc, char* argv[]) {
+    int producers = argc > 2 ? std::atoi(argv[2]) : 64;
+    double seconds = argc > 3 ? std::atof(argv[3]) : 3.0;
+    int points = argc > 4 ? std::atoi(argv[4]) : 16;
+    int publish = argc > 5 ? std::atoi(argv[5]) : 4;
+    if (producers < 1 || seconds <= 0.0 || points < 1 || publish < 1 || publish > 1024) {
+        std::cerr << "Usage: " << argv[0] << " --bench-queue [producers] [seconds] [points_per_batch] [batches_per_push]\n";
+        return 1;
+    }
+    auto report = [](const char* name, const QueueBenchResult& r) {
+        std::cout << std::left << std::setw(8) << name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(8) << r.samples / r.seconds / 1e6 << " M samples/s  "
+                  << r.full_retries << " full retries, " << r.out_of_order << " out of order\n";
+    };
+    std::cout << producers << " producers, " << points << " samples per batch, " << publish << " batches per push\n";
+    MpscQueue<SourceBatch> lock_free(4096);
+    auto a = bench_queue(lock_free, producers, seconds, points, publish);
+    report("mpsc", a);
+    LockedQueue locked(4096);
+    auto b = bench_queue(locked, producers, seconds, points, publish);
+    report("mutex", b);
+    return a.out_of_order == 0 && b.out_of_order == 0 ? 0 : 2;
+}
+
+// Readers look up blocks of a synthetic archive (80% of lookups go to a fifth of the blocks) through a
+// cache a quarter of its size, decoding on a miss, while an evictor thread keeps shrinking the cache.
+// Every block read is checked against its index, so a block freed under a reader shows up as corrupt.
+int tool_bench_cache(int argc, char* argv[]) {
+    int max_readers = argc > 2 ? std::atoi(argv[2]) : 32;
+    double seconds = argc > 3 ? std::atof(argv[3]) : 2.0;
+    if (max_readers < 1 || max_readers > EPOCH_MAX_THREADS - 2 || seconds <= 0.0) {
+        std::cerr << "Usage: " << argv[0] << " --bench-cache [readers] [seconds]\n";
+        return 1;
+    }
+    const size_t total_blocks = 1024;
+    uint64_t corrupt_total = 0;
+    std::cout << "readers  lookups/s   hit rate  evictions  reclaimed  pending  corrupt\n";
+    for (int readers = 1; readers <= max_readers; readers = readers == max_readers ? max_readers + 1 : std::min(max_readers, readers * 2)) {
+        BlockCache cache(total_blocks / 4);
+        std::atomic<bool> stop{false};
+        std::atomic<uint64_t> lookups{0}, corrupt{0};
+        std::vector<std::thread> threads;
+        for (int r = 0; r < readers; ++r) {
+            threads.emplace_back([&, r] {
+                uint64_t rng = 0x9E3779B97F4A7C15ull * (r + 1), local = 0, bad = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    rng ^= rng << 13;
+                    rng ^= rng >> 7;
+                    rng ^= rng << 17;
+                    size_t b = rng % 10 < 8 ? rng / 10 % (total_blocks / 5) : rng / 10 % total_blocks;
+                    BlockCache::Guard guard(cache.domain());
+                    const DecodedBlock* block = cache.find(1, b);
+                    if (!block) {
+                        std::vector<DataPoint> points(ARCHIVE_BLOCK_RECORDS);
+                        for (size_t k = 0; k < points.size(); ++k)
+                            points[k] = {20.0f, 1000.0f, static_cast<time_t>(b * ARCHIVE_BLOCK_RECORDS + k)};
+                        block = cache.insert(1, b, std::move(points));
+                    }
+                    size_t k = rng % ARCHIVE_BLOCK_RECORDS;
+                    if (block->index != b || block->points[k].timestamp != static_cast<time_t>(b * ARCHIVE_BLOCK_RECORDS + k)) ++bad;
+                    ++local;
+                }
+                lookups += local;
+                corrupt += bad;
+            });
+        }
+        std::thread evictor([&] {
+            while (!stop.load(std::memory_order_relaxed)) {
+                cache.shrink();
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        });
+        uint64_t start = now_us();
+        std::this_thread::sleep_for(std::chrono::microseconds(static_cast<uint64_t>(seconds * 1e6)));
+        stop = true;
+        for (auto& t : threads) t.join();
+        evictor.join();
+        double elapsed = (now_us() - start) / 1e6;
+        for (int i = 0; i < 3; ++i) cache.domain().collect();
+        uint64_t hits = cache.get_hits(), misses = cache.get_misses();
+        std::cout << std::setw(7) << readers << std::setw(11) << std::fixed << std::setprecision(2) << lookups / elapsed / 1e6 << "M"
+                  << std::setw(10) << std::setprecision(1) << 100.0 * hits / std::max<uint64_t>(1, hits + misses) << "%"
+                  << std::setw(11) << cache.get_evictions() << std::setw(11) << cache.domain().get_freed()
+                  << std::setw(9) << cache.domain().get_pending() << std::setw(9) << corrupt << "\n";
+        corrupt_total += corrupt;
+    }
+    return corrupt_total == 0 ? 0 : 2;
+}
+
+// Spins for the given amount of this thread's CPU time, so a frame costs more wall time when other
+// processes compete for the CPU, as a real render would.
+void burn_thread_cpu(uint64_t us) {
+    auto cpu_us = [] {
+        timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000u + ts.tv_nsec / 1000;
+    };
+    uint64_t start = cpu_us();
+    while (cpu_us() - start < us) {
+    }
+}
+
+int tool_stress(int argc, char* argv[]) {
+    double duration = argc > 2 ? std::atof(argv[2]) : 30.0;
+    int rate_hz = argc > 3 ? std::atoi(argv[3]) : 2000;
+    int frame_ms = argc > 4 ? std::atoi(argv[4]) : 100;
+    int hogs = argc > 5 ? std::atoi(argv[5]) : 4;
+    bool shed = argc <= 6 || std::string(argv[6]) != "noshed";
+    if (duration <= 0.0 || rate_hz < 1 || rate_hz > 100000 || frame_ms < 0 || hogs < 0) {
+        std::cerr << "Usage: " << argv[0] << " --stress [seconds] [rate_hz] [frame_ms] [hogs] [shed|noshed]\n";
+        return 1;
+    }
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (master == -1 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        std::cerr << "Failed to create pty: " << strerror(errno) << "\n";
+        return 1;
+    }
+    std::unique_ptr<SerialPort> port;
+    try {
+        port = std::make_unique<SerialPort>(ptsname(master), B115200, FlowControl::Off);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        close(master);
+        return 1;
+    }
+
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> hog_threads;
+    for (int i = 0; i < hogs; ++i)
+        hog_threads.emplace_back([&stop] {
+            volatile uint64_t x = 0;
+            while (!stop) ++x;
+        });
+
+    uint64_t received = 0, lost = 0, parse_errors = 0;
+    std::optional<int> last_seq;
+    SampleParser parser(
+        [&](float temp, float) {
+            int seq = static_cast<int>(std::lround((temp - 20.0f) * 100.0f));
+            if (last_seq) lost += (seq - *last_seq - 1 + 6000) % 6000;
+            last_seq = seq;
+            ++received;
+        },
+        [&](const std::string&) { ++parse_errors; });
+
+    // Mirrors BMP280Gui::run(): ingest first, then a frame if the shedder allows one. A frame costs
+    // frame_ms of CPU at full detail and proportionally less when fewer points are drawn. Like the
+    // GUI, which draws its first frame before data flows, one frame is drawn before the device starts.
+    LoadShedder shedder;
+    uint64_t t0 = now_us();
+    burn_thread_cpu(static_cast<uint64_t>(frame_ms) * 1000u);
+    shedder.frame_started(t0);
+    shedder.frame_done(now_us() - t0);
+    shedder.update(0, 0, now_us());
+
+    SimulatedDevice device{master, FlowControl::Off, rate_hz, duration};
+    std::thread device_thread(&SimulatedDevice::run, &device);
+    int fd = port->get();
+    uint64_t frames = 0, max_gap = 0, last_read = now_us(), last_data = last_read;
+    int max_level = 0;
+    while (!device.done || now_us() - last_data < 500000) {
+        uint64_t loop_start = now_us(), frame_cost = 0;
+        int queued = 0;
+        ioctl(fd, FIONREAD, &queued);
+        max_gap = std::max(max_gap, loop_start - last_read);
+        last_read = loop_start;
+        for (int i = 0; i < SERIAL_MAX_READS; ++i) {
+            if (parser.free_space() == 0) parser.reset();
+            int len = read(fd, parser.write_ptr(), parser.free_space());
+            if (len <= 0) break;
+            parser.commit(len);
+            last_data = now_us();
+        }
+        if (!shed || shedder.frame_due(now_us())) {
+            uint64_t t0 = now_us();
+            burn_thread_cpu(static_cast<uint64_t>(frame_ms) * 1000u / (shed ? shedder.point_stride() : 1));
+            frame_cost = now_us() - t0;
+            shedder.frame_started(t0);
+            shedder.frame_done(frame_cost);
+            ++frames;
+        }
+        shedder.update(now_us() - loop_start - frame_cost, queued, now_us());
+        max_level = std::max(max_level, shedder.get_level());
+        pollfd p = {fd, POLLIN, 0};
+        poll(&p, 1, 10);
+    }
+    stop = true;
+    device_thread.join();
+    for (auto& t : hog_threads) t.join();
+    port.reset();
+    close(master);
+
+    uint64_t total_lost = lost + (device.generated - std::min(device.generated, received + lost));
+    std::cout << "load shedding:     " << (shed ? "on" : "off") << "\n"
+              << "cpu hogs:          " << hogs << "\n"
+              << "generated:         " << device.generated << "\n"
+              << "received:          " << received << "\n"
+              << "lost:              " << total_lost << "\n"
+              << "parse errors:      " << parse_errors << "\n"
+              << "frames:            " << frames << "\n"
+              << "max ingest gap:    " << std::fixed << std::setprecision(3) << max_gap / 1e6 << " s\n"
+              << "max level:         " << LoadShedder::name(max_level) << "\n"
+              << "transitions:       " << shedder.get_transitions() << "\n";
+    for (int l = 0; l < 4; ++l)
+        std::cout << "time " << std::left << std::setw(13) << std::string(LoadShedder::name(l)) + ":" << std::right
+                  << std::setprecision(1) << shedder.seconds_at(l) << " s\n";
+    return shed && (total_lost > 0 || parse_errors > 0) ? 2 : 0;
+}
+
+// Feeds a decimated stream with some samples held back, the way the GUI ingests it, and compares the
+// hourly rollups and accumulators against the same samples ingested in timestamp order.
+int tool_check_late(int argc, char* argv[]) {
+    int samples = argc > 2 ? std::atoi(argv[2]) : 200000;
+    int rate_hz = argc > 3 ? std::atoi(argv[3]) : 20;
+    int late_every = argc > 4 ? std::atoi(argv[4]) : 37;
+    int delay_s = argc > 5 ? std::atoi(argv[5]) : 3;
+    if (samples < 1 || rate_hz < 2 || late_every < 1 || delay_s < 1) {
+        std::cerr << "Usage: " << argv[0] << " --check-late [samples] [rate_hz] [late_every] [delay_s]\n";
+        return 1;
+    }
+
+    time_t start = period_start(RollupLevel::Hour, time(nullptr), 0);
+    std::vector<DataPoint> generated(samples);
+    for (int i = 0; i < samples; ++i) {
+        double t = static_cast<double>(i) / rate_hz;
+        generated[i] = {static_cast<float>(19.0 + 3.0 * std::sin(t / 900.0) + 0.2 * std::sin(t * 1.7)),
+                        static_cast<float>(1013.0 + 2.0 * std::cos(t / 1300.0)), start + static_cast<time_t>(t)};
+    }
+    std::vector<DataPoint> arrivals;
+    std::deque<DataPoint> held;
+    for (int i = 0; i < samples; ++i) {
+        while (!held.empty() && held.front().timestamp + delay_s <= generated[i].timestamp) {
+            arrivals.push_back(held.front());
+            held.pop_front();
+        }
+        if (i % late_every == late_every - 1) held.push_back(generated[i]);
+        else arrivals.push_back(generated[i]);
+    }
+    arrivals.insert(arrivals.end(), held.begin(), held.end());
+
+    std::vector<AccumulatorDef> defs = {{"hdd", 0, false, 18.0f, true}, *AccumulatorStore::parse_definition("temp>21")};
+    RollupStore ref_rollups(IntegralMethod::Trapezoid);
+    AccumulatorStore ref_accumulators(IntegralMethod::Trapezoid);
+    ref_accumulators.set_definitions(defs);
+    std::vector<DataPoint> ordered = arrivals;
+    std::stable_sort(ordered.begin(), ordered.end(),
+                     [](const DataPoint& a, const DataPoint& b) { return a.timestamp < b.timestamp; });
+    for (const auto& p : ordered) {
+        ref_rollups.add(p);
+        ref_accumulators.add(p);
+    }
+
+    auto decimator = std::make_unique<Decimator>(rate_hz / 2.0);
+    CircularBuffer history;
+    RangeIndex range_index;
+    RollupStore rollups(IntegralMethod::Trapezoid);
+    AccumulatorStore accumulators(IntegralMethod::Trapezoid);
+    accumulators.set_definitions(defs);
+    uint64_t late = 0, dropped = 0, decimated = 0;
+    time_t newest = 0;
+    for (const auto& p : arrivals) {
+        if (p.timestamp < newest) {
+            ++late;
+            if (decimator->active()) ++decimated;
+            bool kept = decimator->active() || history.insert(p);
+            if (!kept || !patch_late(range_index, rollups, accumulators, p)) ++dropped;
+            continue;
+        }
+        newest = p.timestamp;
+        decimator->add(p, [&history](const DataPoint& q, const Envelope&) { history.push(q); });
+        rollups.add(p);
+        range_index.push(p);
+        accumulators.add(p);
+    }
+
+    auto differs = [](double a, double b) { return std::abs(a - b) > 1e-6 * std::max(1.0, std::abs(b)); };
+    uint64_t mismatches = 0;
+    auto got = rollups.buckets(RollupLevel::Hour), want = ref_rollups.buckets(RollupLevel::Hour);
+    for (size_t i = 0; i < std::max(got.size(), want.size()); ++i) {
+        bool bad = i >= got.size() || i >= want.size() || got[i].start != want[i].start;
+        for (int ch = 0; !bad && ch < 2; ++ch) {
+            const auto &g = got[i].channels[ch], &w = want[i].channels[ch];
+            bad = g.count != w.count || differs(g.sum, w.sum) || differs(g.integral, w.integral) ||
+                  differs(g.duration, w.duration);
+        }
+        mismatches += bad;
+    }
+    const auto &got_acc = accumulators.buckets(RollupLevel::Hour), &want_acc = ref_accumulators.buckets(RollupLevel::Hour);
+    for (const auto& [bucket_start, values] : want_acc) {
+        auto it = got_acc.find(bucket_start);
+        bool bad = it == got_acc.end();
+        for (size_t k = 0; !bad && k < values.size(); ++k) bad = differs(it->second[k], values[k]);
+        mismatches += bad;
+    }
+    mismatches += got_acc.size() != want_acc.size();
+
+    std::cout << "samples:           " << samples << "\n"
+              << "late:              " << late << "\n"
+              << "late while decim.: " << decimated << "\n"
+              << "dropped:           " << dropped << "\n"
+              << "hour buckets:      " << want.size() << "\n"
+              << "mismatches:        " << mismatches << "\n";
+    return mismatches > 0 || dropped > 0 || decimated == 0 ? 2 : 0;
+}
+
+int run_tool(int argc, char* argv[]) {
+    std::string tool = argv[1];
+    if (tool == "--motifs") return tool_motifs(argc, argv);
+    if (tool == "--resample") return tool_resample(argc, argv);
+    if (tool == "--rollups") return tool_rollups(argc, argv);
+    if (tool == "--accumulators") return tool_accumulators(argc, argv);
+    if (tool == "--merge") return tool_merge(argc, argv);
+    if (tool == "--export-arrow") return tool_export_arrow(argc, argv);
+    if (tool == "--replay") return tool_replay(argc, argv);
+    if (tool == "--simulate") return tool_simulate(argc, argv);
+    if (tool == "--stress") return tool_stress(argc, argv);
+    if (tool == "--check-late") return tool_check_late(argc, argv);
+    if (tool == "--bench-queue") return tool_bench_queue(argc, argv);
+    if (tool == "--bench-cache") return tool_bench_cache(argc, argv);
+    std::cerr << "Unknown option: " << tool << "\n";
+    return 1;
+}
+
 int main(int argc, char* argv[]) {
+    if (argc > 1 && std::strncmp(argv[1], "--", 2) == 0 && !std::strchr(argv[1], '=')) return run_tool(argc, argv);
     try {
         BMP280Gui app(argc, argv);
         app.run();